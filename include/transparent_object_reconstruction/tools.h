@@ -9,6 +9,8 @@
 #include <pcl/point_types.h>
 #include <pcl/ModelCoefficients.h>
 
+#include <pcl_conversions/pcl_conversions.h>
+
 #include <pcl/common/angles.h>
 #include <pcl/common/common.h>
 #include <pcl/common/distances.h>
@@ -31,10 +33,21 @@
 #include <fstream>
 #include <iomanip>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 #include <limits>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <unordered_set>
 
 #include <transparent_object_reconstruction/common_typedefs.h>
+#include <transparent_object_reconstruction/CompactHoles.h>
 #include <transparent_object_reconstruction/ViewpointInterval.h>
 #include <transparent_object_reconstruction/VoxelViewPointIntervals.h>
 #include <transparent_object_reconstruction/VoxelLabels.h>
@@ -807,12 +820,113 @@ colorPointCloudVector (CloudVector &cloud_vector, uint8_t r, uint8_t g,
 bool
 pointInPolygon2D (const std::vector<Eigen::Vector2i> &polygon, const Eigen::Vector2i &query_point);
 
+/**
+  * @brief: Scanline rasterization of an integer polygon (convex or not). Computes for each
+  * row (2nd coordinate) the spans of cells (1st coordinate) that are inside the polygon,
+  * exactly as determined by 'pointInPolygon2D ()', but at the cost of O(number of rows *
+  * number of crossing edges) instead of one polygon test per cell of the bounding box.
+  *
+  * @param[in] polygon The vertices of the polygon
+  * @param[out] spans The spans as (row, first column, last column) with inclusive bounds,
+  *   ordered by row and ascending columns within a row
+  */
+void
+polygonScanlineSpans2D (const std::vector<Eigen::Vector2i> &polygon, std::vector<Eigen::Vector3i> &spans);
+
+/**
+  * @brief: Computes the convex hull of a set of 2D points (e.g., image coordinates or
+  * coordinates inside a plane) with Andrew's monotone chain algorithm in O(n log n).
+  * The hull vertices are returned counter-clockwise (w.r.t. a right-handed frame), starting
+  * with the lexicographically smallest point; collinear points are not part of the hull.
+  * The output vector and the sort buffer can be reused between calls to avoid allocations.
+  *
+  * @param[in] points The 2D points (Eigen vectors of size 2)
+  * @param[out] hull_indices The indices of the points that form the convex hull
+  * @param[in,out] order Buffer for the sorted point indices
+  */
+template <typename Vector2T> void
+convexHull2D (const std::vector<Vector2T> &points, std::vector<int> &hull_indices,
+    std::vector<int> &order)
+{
+  typedef typename Vector2T::Scalar Scalar;
+  const int nr_points = static_cast<int> (points.size ());
+  hull_indices.clear ();
+  if (nr_points < 3)
+  {
+    for (int i = 0; i < nr_points; ++i)
+    {
+      if (i == 0 || points[i] != points[0])
+        hull_indices.push_back (i);
+    }
+    return;
+  }
+
+  order.resize (nr_points);
+  for (int i = 0; i < nr_points; ++i)
+  {
+    order[i] = i;
+  }
+  std::sort (order.begin (), order.end (), [&points] (int a, int b)
+      {
+        return points[a][0] < points[b][0] || (points[a][0] == points[b][0] && points[a][1] < points[b][1]);
+      });
+
+  // turn of the chain a->b->c: positive for a left turn
+  auto turn = [&points] (int a, int b, int c) -> Scalar
+  {
+    return (points[b][0] - points[a][0]) * (points[c][1] - points[a][1]) -
+      (points[b][1] - points[a][1]) * (points[c][0] - points[a][0]);
+  };
+
+  hull_indices.resize (2 * nr_points);
+  int k = 0;
+  // lower hull
+  for (int i = 0; i < nr_points; ++i)
+  {
+    while (k >= 2 && turn (hull_indices[k - 2], hull_indices[k - 1], order[i]) <= 0)
+      k--;
+    hull_indices[k++] = order[i];
+  }
+  // upper hull
+  for (int i = nr_points - 2, lower_size = k + 1; i >= 0; --i)
+  {
+    while (k >= lower_size && turn (hull_indices[k - 2], hull_indices[k - 1], order[i]) <= 0)
+      k--;
+    hull_indices[k++] = order[i];
+  }
+  // the last point equals the first one
+  hull_indices.resize (k - 1);
+  // all points coincide
+  if (hull_indices.size () == 2 && points[hull_indices[0]] == points[hull_indices[1]])
+    hull_indices.resize (1);
+}
+
 void
 createSampleRays (const LabelCloud::ConstPtr &base_cloud, LabelCloudPtr &ray_cloud,
 //    float sample_dist = STD_SAMPLE_DIST,
     float sample_dist = 0.005f,
     Eigen::Vector3f origin = Eigen::Vector3f::Zero ());
 
+/**
+  * @brief: Rasterizes the frustum that is spanned by the given base points and an origin
+  * into a regular voxel grid. For each base point all voxels that are traversed by the
+  * line segment from the base point to the origin are determined by a 3D digital
+  * differential analyzer (Amanatides & Woo), i.e., the voxel grid is walked directly and
+  * no sample points along the rays are created.
+  * The voxel with key (i,j,k) covers [grid_origin + (i,j,k) * voxel_size,
+  * grid_origin + (i+1,j+1,k+1) * voxel_size).
+  *
+  * @param[in] base_cloud The base points of the frustum (e.g. the samples of a hole)
+  * @param[in] origin The apex of the frustum (e.g. the sensor position)
+  * @param[in] grid_origin The minimum corner of the voxel with key (0,0,0)
+  * @param[in] voxel_size The edge length of the voxels
+  * @param[out] voxel_keys The keys of all voxels traversed by the frustum (each key is
+  *   contained once, in the order of the first visit)
+  */
+void
+rasterizeFrustumVoxels (const LabelCloud::ConstPtr &base_cloud, const Eigen::Vector3f &origin,
+    const Eigen::Vector3f &grid_origin, float voxel_size, std::vector<Eigen::Vector3i> &voxel_keys);
+
 template <class T, class U> T convert(const U&);
 
 template <class T, class U> void insert_coords (const T&, U&);
@@ -1180,12 +1294,10 @@ tesselate3DConvexHull (const typename pcl::PointCloud<PointT>::Ptr &hull_cloud,
   * i.e., that there is a line segment between consecutive point and between the first and
   * the last point as well.
   * While it is assumed that the convex hulls are 2D, they can be arbitrarily oriented in 3D
-  * space.
-  * Note: The function assumes that the convex hulls do not overlap and does in fact not
-  * test for this. If the hulls could overlap (and thus the distance between them should
-  * be 0) a initial check if any point of convex_hull_a lies inside convex_hull_b (or vice
-  * versa) should be performed first to test for overlapping. In general this function will
-  * not return the correct distance, i.e., 0 for overlapping convex hulls.
+  * space; both hulls need to lie in the same plane though.
+  * The hulls are projected into their common plane and the distance is computed with the
+  * Gilbert-Johnson-Keerthi (GJK) algorithm, i.e., the time needed is linear in the number
+  * of hull points. Overlapping or intersecting convex hulls have distance 0.
   *
   * @param[in] convex_hull_a The polygon describing the first convex hull polygon.
   * @param[in] convex_hull_b The polygon describing the second convex hull polygon.
@@ -1193,7 +1305,7 @@ tesselate3DConvexHull (const typename pcl::PointCloud<PointT>::Ptr &hull_cloud,
   */
 float
 convexHullsMinDistance (const std::vector<Eigen::Vector3f> &convex_hull_a,
-    std::vector<Eigen::Vector3f> &convex_hull_b);
+    const std::vector<Eigen::Vector3f> &convex_hull_b);
 
 template <typename PointT> inline float
 convexHullsMinDistance (const typename pcl::PointCloud<PointT>::ConstPtr &convex_hull_a,
@@ -1209,16 +1321,18 @@ convexHullsMinDistance (const typename pcl::PointCloud<PointT>::ConstPtr &convex
 }
 
 /**
-  * @brief Function to check if the distance between two non-intersection 2D convex hulls
-  * is below the given threshold.
+  * @brief Function to check if the distance between two 2D convex hulls is below the given
+  * threshold.
   * Checks if the distance between 2 convex hulls given as vectors of type 'Eigen::Vector3f'
   * is below the specified threshold. It is assumed that the entries in the vectors are
   * ordered properly, i.e., that there is a line segment between consecutive point and
   * between the first and the last point as well.
   * While it is assumed that the convex hulls are 2D, they can be arbitrarily oriented in 3D
-  * space.
-  * Note: Threshold must be positive (unchecked) and the convex hulls should not overlap /
-  * intersect. Otherwise the behaviour is undefined.
+  * space; both hulls need to lie in the same plane though.
+  * Uses the same GJK based distance computation as 'convexHullsMinDistance ()', but stops
+  * as soon as the distance is known to be below or above the threshold. Overlapping hulls
+  * are always closer than a positive threshold.
+  * Note: Threshold must be positive (unchecked).
   *
   * @param[in] convex_hull_a The polygon describing the first convex hull polygon.
   * @param[in] convex_hull_b The polygon describing the second convex hull polygon.
@@ -1228,7 +1342,7 @@ convexHullsMinDistance (const typename pcl::PointCloud<PointT>::ConstPtr &convex
 
 bool
 convexHullDistBelowThreshold (const std::vector<Eigen::Vector3f> &convex_hull_a,
-    std::vector<Eigen::Vector3f> &convex_hull_b, float threshold);
+    const std::vector<Eigen::Vector3f> &convex_hull_b, float threshold);
 
 template <typename PointT> inline bool
 convexHullDistBelowThreshold (const typename pcl::PointCloud<PointT>::ConstPtr &convex_hull_a,
@@ -1270,8 +1384,9 @@ void getPointsOnPositiveSideOfHyperplane (const std::vector<Eigen::Vector3f> &al
     const Eigen::Hyperplane<float, 3> &hyperplane, std::vector<Eigen::Vector3f> &points_on_pos_side);
 
 /**
-  * @brief: Function to check if two 2D convex hulls intersect, i.e., if at least one point of
-  * the first convex hull lies inside the second or vice versa.
+  * @brief: Function to check if two 2D convex hulls intersect, i.e., if their distance as
+  * determined by 'convexHullsMinDistance ()' is 0. In contrast to testing if any vertex of
+  * one hull lies inside the other, this also detects crossing hulls.
   *
   * The convex hulls need to be 2 dimensional (thus they form closed polygons) and be aligned in
   * same hyperplane in 3D space.
@@ -1485,4 +1600,546 @@ void
 convertLabelVectorCollection2VoxelLabelCollection (const std::vector<std::vector<uint32_t> > &vlc,
     std::vector<transparent_object_reconstruction::VoxelLabels> &voxel_label_collection);
 
+/**
+  * @brief: Returns the number of convex hulls stored in a 'CompactHoles' message.
+  */
+inline size_t
+getNrCompactHoles (const transparent_object_reconstruction::CompactHoles &holes)
+{
+  return holes.hull_offsets.empty () ? 0 : holes.hull_offsets.size () - 1;
+}
+
+/**
+  * @brief: Appends the x, y and z coordinates of the points of a convex hull to a 'CompactHoles'
+  * message. Header and plane coefficients of the message are not touched.
+  *
+  * @param[in] hull_cloud The points of the convex hull in consecutive order
+  * @param[in,out] holes The message the hull is appended to
+  */
+template <typename PointT> inline void
+addHullToCompactHoles (const pcl::PointCloud<PointT> &hull_cloud,
+    transparent_object_reconstruction::CompactHoles &holes)
+{
+  if (holes.hull_offsets.empty ())
+  {
+    holes.hull_offsets.push_back (0);
+  }
+  size_t nr_floats = holes.vertices.size ();
+  holes.vertices.resize (nr_floats + 3 * hull_cloud.points.size ());
+  float *vertex = holes.vertices.data () + nr_floats;
+  typename pcl::PointCloud<PointT>::VectorType::const_iterator point_it = hull_cloud.points.begin ();
+  while (point_it != hull_cloud.points.end ())
+  {
+    *vertex++ = point_it->x;
+    *vertex++ = point_it->y;
+    *vertex++ = point_it->z;
+    point_it++;
+  }
+  holes.hull_offsets.push_back (static_cast<uint32_t> (holes.vertices.size () / 3));
+}
+
+/**
+  * @brief: Extracts a single convex hull of a 'CompactHoles' message into a point cloud. Only
+  * the coordinates of the points are set, all other fields keep their default values; the
+  * header of the cloud is taken from the message.
+  *
+  * @param[in] holes The message
+  * @param[in] hull_index The index of the convex hull, needs to be smaller than 'getNrCompactHoles ()'
+  * @param[out] hull_cloud The points of the convex hull in consecutive order
+  */
+template <typename PointT> inline void
+getHullFromCompactHoles (const transparent_object_reconstruction::CompactHoles &holes,
+    size_t hull_index, pcl::PointCloud<PointT> &hull_cloud)
+{
+  const uint32_t begin = holes.hull_offsets[hull_index];
+  const uint32_t end = holes.hull_offsets[hull_index + 1];
+  hull_cloud.points.clear ();
+  hull_cloud.points.resize (end - begin);
+  const float *vertex = holes.vertices.data () + 3 * begin;
+  typename pcl::PointCloud<PointT>::VectorType::iterator point_it = hull_cloud.points.begin ();
+  while (point_it != hull_cloud.points.end ())
+  {
+    point_it->x = *vertex++;
+    point_it->y = *vertex++;
+    point_it->z = *vertex++;
+    point_it++;
+  }
+  hull_cloud.width = hull_cloud.points.size ();
+  hull_cloud.height = 1;
+  hull_cloud.is_dense = true;
+  pcl_conversions::toPCL (holes.header, hull_cloud.header);
+}
+
+/**
+  * @brief: Compact fixed-width representation of the viewpoint labels present in a voxel.
+  * Bit i of the mask is set if label i was observed, the bits are stored in consecutive
+  * 64 bit words (bit i resides in word i / 64 at position i % 64).
+  */
+typedef std::vector<uint64_t> ViewpointMask;
+
+/**
+  * @brief: Resizes and clears a viewpoint mask, so that it can hold 'angle_resolution' labels.
+  *
+  * @param[out] mask The viewpoint mask that is initialized
+  * @param[in] angle_resolution The number of distinguishable viewpoint labels
+  */
+void
+initViewpointMask (ViewpointMask &mask, int angle_resolution);
+
+/**
+  * @brief: Marks the given label in the viewpoint mask. Labels that exceed the angle resolution
+  * are wrapped around, i.e., label 'angle_resolution' corresponds to label 0.
+  *
+  * @param[in,out] mask The viewpoint mask, needs to be initialized via 'initViewpointMask ()'
+  * @param[in] label The label that will be marked
+  * @param[in] angle_resolution The number of distinguishable viewpoint labels
+  */
+inline void
+setViewpointMaskLabel (ViewpointMask &mask, uint32_t label, int angle_resolution)
+{
+  label %= static_cast<uint32_t> (angle_resolution);
+  mask[label >> 6] |= (static_cast<uint64_t> (1) << (label & 63));
+}
+
+/**
+  * @brief: Returns the number of labels that are marked in the given viewpoint mask.
+  */
+size_t
+countViewpointMaskLabels (const ViewpointMask &mask);
+
+/**
+  * @brief: Converts a viewpoint mask into the (ascending) vector of contained labels.
+  *
+  * @param[in] mask The viewpoint mask
+  * @param[out] labels The labels that are marked in the mask
+  */
+void
+convertViewpointMask2LabelVector (const ViewpointMask &mask, std::vector<uint32_t> &labels);
+
+/**
+  * @brief: Computes the circular dilation of a viewpoint mask, i.e., every marked label l
+  * marks all labels in [l - opening_angle, l + opening_angle] (modulo 'angle_resolution')
+  * in the output mask. The dilation operates on whole 64 bit words (shift-or with a
+  * logarithmic number of steps), so that the cost is independent of the number of marked
+  * labels. The opening angle needs to be smaller than the angle resolution.
+  *
+  * @param[in] mask The viewpoint mask that is dilated
+  * @param[in] angle_resolution The number of distinguishable viewpoint labels
+  * @param[in] opening_angle The number of labels that are marked on either side of a label
+  * @param[out] dilated The dilated viewpoint mask
+  */
+void
+dilateViewpointMask (const ViewpointMask &mask, int angle_resolution, int opening_angle,
+    ViewpointMask &dilated);
+
+/**
+  * @brief: Converts a (dilated) viewpoint mask into the 'VoxelViewPointIntervals' message
+  * representation, i.e., each maximal run of marked labels in [0, angle_resolution - 1]
+  * is represented by a closed interval. Runs that wrap around are split at label 0.
+  *
+  * @param[in] mask The viewpoint mask
+  * @param[in] angle_resolution The number of distinguishable viewpoint labels
+  * @param[out] voxel_vp_intervals The intervals of marked labels in ascending order
+  */
+void
+convertViewpointMask2VoxelViewpointIntervals (const ViewpointMask &mask, int angle_resolution,
+    transparent_object_reconstruction::VoxelViewPointIntervals &voxel_vp_intervals);
+
+/**
+  * @brief: Reference implementation of the viewpoint coverage based on boost::icl intervals.
+  * Each label contributes the closed interval [label - opening_angle, label + opening_angle],
+  * intervals that exceed [0, angle_resolution - 1] are wrapped around. The resulting
+  * intervals are identical to the ones obtained via 'dilateViewpointMask ()' and
+  * 'convertViewpointMask2VoxelViewpointIntervals ()'.
+  *
+  * @param[in] labels The (ascending) labels present in a voxel
+  * @param[in] angle_resolution The number of distinguishable viewpoint labels
+  * @param[in] opening_angle The number of labels that are covered on either side of a label
+  * @param[out] vp_intervals The accumulated viewpoint intervals
+  */
+void
+computeViewpointIntervalsICL (const std::vector<uint32_t> &labels, int angle_resolution,
+    int opening_angle, boost::icl::interval_set<int> &vp_intervals);
+
+/**
+  * @brief: Disjoint-set forest (union-find) over integer elements, e.g. pixel indices.
+  * Each set is represented by its smallest element, so that representatives don't depend
+  * on the order of the union operations, and every parent index is smaller than or equal
+  * to the index of its child. Only elements that were added via 'makeSet ()' may be used.
+  */
+struct UnionFind
+{
+  /**
+    * @brief: Provides storage for the elements [0, size); the elements are not initialized.
+    */
+  void resize (size_t size)
+  {
+    parent.resize (size);
+  }
+
+  /**
+    * @brief: Adds the given element as a singleton set.
+    */
+  void makeSet (int element)
+  {
+    parent[element] = element;
+  }
+
+  /**
+    * @brief: Returns the representative (i.e., smallest element) of the set containing
+    * the given element; uses path halving.
+    */
+  int find (int element)
+  {
+    while (parent[element] != element)
+    {
+      parent[element] = parent[parent[element]];
+      element = parent[element];
+    }
+    return element;
+  }
+
+  /**
+    * @brief: Merges the sets containing the given elements and returns the representative
+    * of the merged set.
+    */
+  int unite (int element_a, int element_b)
+  {
+    element_a = find (element_a);
+    element_b = find (element_b);
+    if (element_a < element_b)
+    {
+      parent[element_b] = element_a;
+      return element_a;
+    }
+    parent[element_a] = element_b;
+    return element_b;
+  }
+
+  std::vector<int> parent;
+};
+
+/**
+  * @brief: Reusable per-pixel buffer for images and organized point clouds. Values are
+  * stored in row-major order (pixel (u,v) at index v * width + u) in a single block of
+  * memory that is aligned to cache lines (64 bytes). The memory is only reallocated if the
+  * dimensions change, so a buffer that is owned by a long-living object causes no heap
+  * allocations for images of constant size. Intended for plain data types only.
+  */
+template <typename T>
+class ImageBuffer
+{
+  public:
+    ImageBuffer () : data_ (NULL), width_ (0), height_ (0) {};
+
+    ImageBuffer (const ImageBuffer &other) : data_ (NULL), width_ (0), height_ (0)
+    {
+      *this = other;
+    };
+
+    ~ImageBuffer ()
+    {
+      free (data_);
+    };
+
+    ImageBuffer& operator= (const ImageBuffer &other)
+    {
+      if (this != &other)
+      {
+        resize (other.width_, other.height_);
+        if (other.size () > 0)
+          memcpy (data_, other.data_, other.size () * sizeof (T));
+      }
+      return *this;
+    };
+
+    /**
+      * @brief: Sets the dimensions of the buffer. If they differ from the current ones, the
+      * buffer is reallocated and all values are set to 'value'; otherwise the buffer
+      * (including its contents) stays untouched.
+      *
+      * @returns true, if the buffer was reallocated, false otherwise
+      */
+    bool resize (int width, int height, const T &value = T ())
+    {
+      if (data_ != NULL && width == width_ && height == height_)
+        return false;
+      free (data_);
+      data_ = NULL;
+      width_ = width;
+      height_ = height;
+      size_t bytes = ((std::max<size_t> (size (), 1) * sizeof (T) + 63) / 64) * 64;
+      if (posix_memalign (reinterpret_cast<void**> (&data_), 64, bytes) != 0)
+      {
+        data_ = NULL;
+        width_ = height_ = 0;
+        throw std::bad_alloc ();
+      }
+      fill (value);
+      return true;
+    };
+
+    /**
+      * @brief: Sets all values of the buffer to 'value'.
+      */
+    void fill (const T &value)
+    {
+      std::fill (data_, data_ + size (), value);
+    };
+
+    /**
+      * @brief: Sets the values inside the given (inclusive) bounding box to 'value'.
+      */
+    void fill (const T &value, const Eigen::Vector2i &min, const Eigen::Vector2i &max)
+    {
+      for (int v = min[1]; v <= max[1]; ++v)
+      {
+        std::fill (data_ + v * width_ + min[0], data_ + v * width_ + max[0] + 1, value);
+      }
+    };
+
+    /**
+      * @brief: Exchanges the contents (and dimensions) of two buffers without copying.
+      */
+    void swap (ImageBuffer &other)
+    {
+      std::swap (data_, other.data_);
+      std::swap (width_, other.width_);
+      std::swap (height_, other.height_);
+    };
+
+    T& operator() (int u, int v) { return data_[v * width_ + u]; };
+    const T& operator() (int u, int v) const { return data_[v * width_ + u]; };
+    T& operator[] (size_t index) { return data_[index]; };
+    const T& operator[] (size_t index) const { return data_[index]; };
+
+    T* data () { return data_; };
+    const T* data () const { return data_; };
+    int width () const { return width_; };
+    int height () const { return height_; };
+    size_t size () const { return static_cast<size_t> (width_) * height_; };
+
+  private:
+    T *data_;
+    int width_;
+    int height_;
+};
+
+/**
+  * @brief: Computes for each point of an organized cloud whether it is finite (1) or
+  * not (0), i.e., the result of pcl::isFinite (). The test is done on the exponent bits
+  * of the coordinates without branches, so that the loop can be vectorized by the
+  * compiler. Subsequent neighborhood queries can then use the compact mask instead of
+  * loading the complete point structs.
+  *
+  * @param[in] cloud The organized input cloud
+  * @param[out] finite_mask The finite mask of the cloud, resized to the dimensions of the cloud
+  */
+template <typename PointT> void
+computeFiniteMask (const pcl::PointCloud<PointT> &cloud, ImageBuffer<char> &finite_mask)
+{
+  finite_mask.resize (cloud.width, cloud.height);
+  const uint32_t exponent_bits = 0x7f800000;
+  const PointT *points = &cloud.points[0];
+  char *mask = finite_mask.data ();
+  for (size_t i = 0; i < finite_mask.size (); ++i)
+  {
+    uint32_t x, y, z;
+    memcpy (&x, &points[i].x, sizeof (uint32_t));
+    memcpy (&y, &points[i].y, sizeof (uint32_t));
+    memcpy (&z, &points[i].z, sizeof (uint32_t));
+    mask[i] = ((x & exponent_bits) != exponent_bits) & ((y & exponent_bits) != exponent_bits) &
+      ((z & exponent_bits) != exponent_bits);
+  }
+}
+
+/**
+  * @brief: Compares two buffers of identical dimensions tile by tile and marks each tile
+  * that contains at least one differing value. The rows of a tile are compared as 64 bit
+  * words that are XORed and ORed into an accumulator without early exit, so that the
+  * compiler can vectorize the inner loop.
+  *
+  * @param[in] buffer_a The first buffer
+  * @param[in] buffer_b The second buffer, needs to have the dimensions of 'buffer_a'
+  * @param[in] tile_size The edge length of the (square) tiles in pixels
+  * @param[out] changed_tiles One entry per tile, 1 if the tile differs and 0 otherwise
+  *
+  * @returns the number of differing tiles
+  */
+template <typename T> size_t
+diffImageBufferTiles (const ImageBuffer<T> &buffer_a, const ImageBuffer<T> &buffer_b,
+    int tile_size, ImageBuffer<char> &changed_tiles)
+{
+  const int nr_tiles_u = (buffer_a.width () + tile_size - 1) / tile_size;
+  const int nr_tiles_v = (buffer_a.height () + tile_size - 1) / tile_size;
+  changed_tiles.resize (nr_tiles_u, nr_tiles_v);
+  size_t nr_changed = 0;
+  for (int tile_v = 0; tile_v < nr_tiles_v; ++tile_v)
+  {
+    const int v_end = std::min ((tile_v + 1) * tile_size, buffer_a.height ());
+    for (int tile_u = 0; tile_u < nr_tiles_u; ++tile_u)
+    {
+      const int u_begin = tile_u * tile_size;
+      const size_t row_bytes = std::min (tile_size, buffer_a.width () - u_begin) * sizeof (T);
+      const size_t nr_words = row_bytes / sizeof (uint64_t);
+      uint64_t difference = 0;
+      for (int v = tile_v * tile_size; v < v_end; ++v)
+      {
+        const unsigned char *row_a = reinterpret_cast<const unsigned char*> (&buffer_a (u_begin, v));
+        const unsigned char *row_b = reinterpret_cast<const unsigned char*> (&buffer_b (u_begin, v));
+        for (size_t w = 0; w < nr_words; ++w)
+        {
+          uint64_t word_a, word_b;
+          memcpy (&word_a, row_a + w * sizeof (uint64_t), sizeof (uint64_t));
+          memcpy (&word_b, row_b + w * sizeof (uint64_t), sizeof (uint64_t));
+          difference |= word_a ^ word_b;
+        }
+        for (size_t i = nr_words * sizeof (uint64_t); i < row_bytes; ++i)
+        {
+          difference |= row_a[i] ^ row_b[i];
+        }
+      }
+      changed_tiles (tile_u, tile_v) = difference != 0;
+      nr_changed += difference != 0;
+    }
+  }
+  return nr_changed;
+}
+
+/**
+  * @brief: Returns the number of threads to use for a requested number of threads, i.e.,
+  * 'nr_threads' itself or the number of cores if 'nr_threads' is 0.
+  */
+inline size_t
+resolveNrThreads (size_t nr_threads)
+{
+  return nr_threads > 0 ? nr_threads : std::max (std::thread::hardware_concurrency (), 1u);
+}
+
+/**
+  * @brief: Calls 'function (i)' for all i in [0, nr_items) using up to 'nr_threads' threads
+  * (the calling thread included). Items are handed out one at a time, so the order in
+  * which they are processed is unspecified; results should therefore be written into
+  * per-item slots and merged by the caller afterwards. The function returns once all
+  * items are processed. If 'function' throws, no further items are handed out and the
+  * first exception is rethrown on the calling thread.
+  * The threads are started and joined on every call, use 'ThreadPool' for repeated calls.
+  *
+  * @param[in] nr_items The number of items
+  * @param[in] nr_threads The maximal number of threads, 0 uses one thread per core
+  * @param[in] function The function that is called for each item index
+  */
+template <typename FunctionT> inline void
+parallelFor (size_t nr_items, size_t nr_threads, const FunctionT &function)
+{
+  nr_threads = std::min (resolveNrThreads (nr_threads), nr_items);
+  if (nr_threads <= 1)
+  {
+    for (size_t i = 0; i < nr_items; ++i)
+    {
+      function (i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next_item (0);
+  std::mutex exception_mutex;
+  std::exception_ptr exception;
+  auto worker = [&] ()
+  {
+    size_t i;
+    while ((i = next_item++) < nr_items)
+    {
+      try
+      {
+        function (i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock (exception_mutex);
+        if (!exception)
+        {
+          exception = std::current_exception ();
+        }
+        next_item = nr_items;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve (nr_threads - 1);
+  for (size_t t = 1; t < nr_threads; ++t)
+  {
+    threads.push_back (std::thread (worker));
+  }
+  worker ();
+  for (size_t t = 0; t < threads.size (); ++t)
+  {
+    threads[t].join ();
+  }
+  if (exception)
+  {
+    std::rethrow_exception (exception);
+  }
+}
+
+/**
+  * @brief: Persistent set of worker threads for repeated 'parallelFor' calls, so that the
+  * threads are not started and joined for every call. The calling thread takes part in
+  * the processing of the items. A pool processes one 'parallelFor' at a time, i.e., it
+  * must not be used concurrently from several threads or from within 'function'.
+  */
+class ThreadPool
+{
+  public:
+    /**
+      * @brief: Starts the workers of a pool for 'nr_threads' threads (the calling thread
+      * included), 0 uses one thread per core.
+      */
+    explicit ThreadPool (size_t nr_threads = 0);
+
+    /**
+      * @brief: Stops and joins the workers.
+      */
+    ~ThreadPool ();
+
+    /**
+      * @brief: Returns the number of threads of the pool (the calling thread included).
+      */
+    size_t size () const { return workers_.size () + 1; };
+
+    /**
+      * @brief: Same as the free 'parallelFor', but runs on the workers of the pool. At most
+      * 'nr_threads' (0: all) threads of the pool process the items. If 'function' throws,
+      * no further items are handed out and the first exception is rethrown on the calling
+      * thread once all running items are finished.
+      */
+    template <typename FunctionT> void
+    parallelFor (size_t nr_items, size_t nr_threads, const FunctionT &function)
+    {
+      run (nr_items, nr_threads, [&function] (size_t i) { function (i); });
+    };
+
+  private:
+    ThreadPool (const ThreadPool&);
+    ThreadPool& operator= (const ThreadPool&);
+
+    void run (size_t nr_items, size_t nr_threads, const std::function<void (size_t)> &job);
+    void processItems ();
+    void workerLoop ();
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable job_condition_;
+    std::condition_variable done_condition_;
+    // state of the current job, guarded by 'mutex_' (except for the atomic item counter)
+    const std::function<void (size_t)> *job_;
+    size_t nr_items_;
+    std::atomic<size_t> next_item_;
+    size_t job_id_;
+    size_t nr_open_slots_;
+    size_t nr_running_workers_;
+    std::exception_ptr exception_;
+    bool stop_;
+};
+
 #endif // TRANSP_OBJ_RECON_TOOLS
@@ -25,20 +25,14 @@
 
 #include <pcl/io/pcd_io.h>
 
-#include <pcl/octree/octree.h>
-#include <pcl/octree/octree_impl.h>
-#include <pcl/octree/octree_iterator.h>
-
-// boost interval stuff for alternative implementation of viewpoint overlap based reconstruction...
-#include <boost/icl/interval_set.hpp>
-#include <boost/icl/discrete_interval.hpp>
-
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <deque>
 
 #include <transparent_object_reconstruction/common_typedefs.h>
 #include <transparent_object_reconstruction/Holes.h>
+#include <transparent_object_reconstruction/CompactHoles.h>
 #include <transparent_object_reconstruction/tools.h>
 #include <transparent_object_reconstruction/HoleIntersectorReset.h>
 
@@ -46,11 +40,88 @@
 #include <transparent_object_reconstruction/VoxelViewPointIntervals.h>
 #include <transparent_object_reconstruction/VoxelizedTransObjInfo.h>
 #include <transparent_object_reconstruction/VoxelLabels.h>
+#include <transparent_object_reconstruction/TfQueueStatus.h>
 
 #include <bag_loop_check/bag_loop_check.hpp>
 
-typedef pcl::octree::OctreePointCloud<LabelPoint> LabelOctree;
-typedef pcl::octree::OctreeContainerPointIndices LeafContainer;
+struct Vector3iComp {
+    bool operator() (const Eigen::Vector3i &lhs, const Eigen::Vector3i &rhs) const
+    {
+      if (lhs[0] != rhs[0])
+        return lhs[0] < rhs[0];
+      if (lhs[1] != rhs[1])
+        return lhs[1] < rhs[1];
+      return lhs[2] < rhs[2];
+    }
+};
+
+/* Persistent representation of a single voxel of the intersection grid.
+ * Instead of the frustum points that fall into the voxel only a fixed-width
+ * bitset of the contained viewpoint labels and the number of hole frusta that
+ * traverse the voxel are stored, so that the memory consumption depends on the
+ * number of occupied voxels rather than on the number of collected frusta.
+ * 'nr_frusta' counts each frustum (one per hole and view) once, no matter how
+ * many of its rays pass through the voxel; this equals the number of points of
+ * the former voxelized frustum clouds inside the voxel.
+ * Additionally the result of the last evaluation of the voxel is cached, so
+ * that only voxels that were touched by new frusta need to be re-evaluated.
+ */
+struct VoxelLeaf
+{
+  VoxelLeaf () : nr_frusta (0), filled (false), in_intersection (false), nr_vp_marks (0) {};
+
+  ViewpointMask label_mask;
+  uint32_t nr_frusta;
+  bool filled;
+  bool in_intersection;
+  ViewpointMask vp_mask;
+  uint32_t nr_vp_marks;
+};
+
+typedef std::map<Eigen::Vector3i, VoxelLeaf, Vector3iComp> VoxelLeafMap;
+typedef std::set<Eigen::Vector3i, Vector3iComp> VoxelKeySet;
+
+/* Intermediate results of the processing of a single convex hull of a 'Holes'
+ * message. Hulls are processed independently (possibly in parallel) and their
+ * results are merged in the order of the hulls afterwards.
+ */
+struct HullResult
+{
+  HullResult () : has_frustum_marker (false) {};
+
+  LabelCloudPtr hole_hull;
+  LabelCloudPtr xy_hole_sample_cloud;
+  bool has_frustum_marker;
+  visualization_msgs::Marker frustum_marker;
+  std::vector<Eigen::Vector3i> frustum_voxels;
+};
+
+/* A received view (the decoded hulls of a holes message) that waits for the transforms
+ * of its time stamp.
+ */
+struct PendingView
+{
+  std_msgs::Header header;
+  std::vector<HullResult> hull_results;
+  ros::Time received;
+};
+
+/* Output of the collection of a contiguous range of voxels. Ranges are
+ * collected independently (possibly in parallel) and their slabs are
+ * concatenated in the order of the voxels afterwards.
+ */
+struct IntersectionSlab
+{
+  LabelCloud::VectorType intersec_points;
+  std::vector<geometry_msgs::Point> intersec_marker_points;
+  std::vector<geometry_msgs::Point> non_intersec_marker_points;
+  LabelCloud::VectorType voxel_centers;
+  std::vector<std::vector<uint32_t> > voxel_labels;
+  std::vector<transparent_object_reconstruction::VoxelViewPointIntervals> voxel_vp_intervals;
+};
+
+// number of voxels that are evaluated / collected as one unit of parallel work
+static const size_t VOXEL_CHUNK_SIZE = 1024;
 
 class HoleIntersector
 {
@@ -69,6 +140,15 @@ class HoleIntersector
       param_handle_.param<int> ("angle_resolution", angle_resolution_, ANGLE_RESOLUTION);
       param_handle_.param<int> ("opening_angle", opening_angle_, OPENING_ANGLE);
       param_handle_.param<int> ("min_bin_marks", min_bin_marks_, MIN_BIN_MARKS);
+      param_handle_.param<bool> ("incremental_intersection", incremental_, false);
+      // in the incremental mode only the delta is published per view, the complete
+      // intersection is published at most once per period (in seconds)
+      param_handle_.param<double> ("full_publish_period", full_publish_period_, 1.0);
+      // number of threads used to process the holes of a view (0: one per core)
+      param_handle_.param<int> ("nr_hull_threads", nr_hull_threads_, 0);
+      // number of threads used to evaluate the voxels (0: one per core)
+      param_handle_.param<int> ("nr_evaluation_threads", nr_evaluation_threads_, 0);
+      setUpThreadPool ();
 
       vis_pub_ = nhandle_.advertise<visualization_msgs::MarkerArray>( "transObjRec/intersec_visualization", 10, true);
       all_frusta_pub_ = nhandle_.advertise<visualization_msgs::MarkerArray>( "transObjRec/frusta_visualization", 10, true);
@@ -77,17 +157,45 @@ class HoleIntersector
 
       trans_obj_info_pub_ = nhandle_.advertise<transparent_object_reconstruction::VoxelizedTransObjInfo>
         ("transObjRec/voxelized_info", 10, true);
+      trans_obj_info_delta_pub_ = nhandle_.advertise<transparent_object_reconstruction::VoxelizedTransObjInfo>
+        ("transObjRec/voxelized_info_delta", 10, false);
+
+      tf_queue_status_pub_ = nhandle_.advertise<transparent_object_reconstruction::TfQueueStatus>
+        ("transObjRec/tf_queue_status", 10, true);
 
       reset_service_ = nhandle_.advertiseService ("transObjRec/HoleIntersector_reset", &HoleIntersector::reset, this);
 
-      hole_sub_ = nhandle_.subscribe ("table_holes", 1, &HoleIntersector::add_holes_cb, this);
+      // views whose transforms are not available yet are queued and retried periodically
+      param_handle_.param<int> ("max_pending_views", max_pending_views_, 10);
+      param_handle_.param<double> ("pending_timeout", pending_timeout_, 50.0);
+      double pending_retry_period;
+      param_handle_.param<double> ("pending_retry_period", pending_retry_period, 0.05);
+      nr_processed_views_ = nr_dropped_overflow_ = nr_dropped_timeout_ = nr_embedded_fallbacks_ = 0;
+      retry_timer_ = nhandle_.createTimer (ros::Duration (pending_retry_period),
+          &HoleIntersector::retry_pending_cb, this);
+
+      full_state_outdated_ = false;
+      full_publish_timer_ = nhandle_.createTimer (ros::Duration (std::max (full_publish_period_, 0.01)),
+          &HoleIntersector::publish_full_cb, this);
+
+      // receive the holes as CompactHoles instead of Holes messages
+      param_handle_.param<bool> ("compact_holes", compact_holes_, false);
+      // use the transforms embedded into the CompactHoles messages instead of waiting for tf
+      // (implies 'compact_holes')
+      param_handle_.param<bool> ("use_embedded_transforms", use_embedded_transforms_, false);
+      if (compact_holes_ || use_embedded_transforms_)
+      {
+        hole_sub_ = nhandle_.subscribe ("table_holes_compact", 1, &HoleIntersector::add_compact_holes_cb, this);
+      }
+      else
+      {
+        hole_sub_ = nhandle_.subscribe ("table_holes", 1, &HoleIntersector::add_holes_cb, this);
+      }
 
-      octree_.reset (new LabelOctree (octree_resolution_));
-      all_frusta_ = boost::make_shared<LabelCloud> ();
       intersec_cloud_ = boost::make_shared<LabelCloud> ();
       voxelized_intersec_cloud_ = boost::make_shared<LabelCloud> ();
 
-      // indicate that reference bounding box for octree isn't set yet
+      // indicate that reference bounding box for the voxel grid isn't set yet
       reference_bb_set_ = false;
 
     };
@@ -104,9 +212,63 @@ class HoleIntersector
 
       ros::Time cb_start_time = ros::Time::now ();
 
+      // convert all convex hulls: sensor_msgs::PointCloud2 to PCLPointCloud2 to pcl::PointCloud<T>
+      std::vector<HullResult> hull_results (holes->convex_hulls.size ());
+      pcl::console::setVerbosityLevel (pcl::console::L_ALWAYS);
+      for (size_t i = 0; i < holes->convex_hulls.size (); ++i)
+      {
+        pcl::PCLPointCloud2 pcl_pc2;
+        pcl_conversions::toPCL (holes->convex_hulls[i], pcl_pc2);
+        hull_results[i].hole_hull = boost::make_shared<LabelCloud> ();
+        pcl::fromPCLPointCloud2 (pcl_pc2, *hull_results[i].hole_hull);
+      }
+      pcl::console::setVerbosityLevel (pcl::console::L_INFO);
+
+      ROS_DEBUG ("finished conversion of %lu hole hulls", hull_results.size ());
+
+      addView (holes->convex_hulls.front ().header, hull_results, cb_start_time);
+    };
+
+    void add_compact_holes_cb (const transparent_object_reconstruction::CompactHoles::ConstPtr &holes)
+    {
+      ROS_DEBUG ("went into callback, msg size: %lu", getNrCompactHoles (*holes));
+
+      if (getNrCompactHoles (*holes) == 0)
+      {
+        ROS_WARN ("received empty CompactHoles message; ignoring");
+        return;
+      }
+
+      ros::Time cb_start_time = ros::Time::now ();
+
+      // the compact message only carries the coordinates of the hull points
+      std::vector<HullResult> hull_results (getNrCompactHoles (*holes));
+      for (size_t i = 0; i < hull_results.size (); ++i)
+      {
+        hull_results[i].hole_hull = boost::make_shared<LabelCloud> ();
+        getHullFromCompactHoles (*holes, i, *hull_results[i].hole_hull);
+      }
+
+      ROS_DEBUG ("finished conversion of %lu hole hulls", hull_results.size ());
+
+      addView (holes->header, hull_results, cb_start_time,
+          use_embedded_transforms_ ? holes.get () : NULL);
+    };
+
+    /* Handles a received view (given as decoded convex hulls in the sensor frame described
+     * by 'header'). Views with valid embedded transforms are integrated at once, all others
+     * (including views whose embedded transforms are missing or don't match the frames) are
+     * appended to the queue of views that wait for their transforms via tf, thus the
+     * callbacks never block. The queue holds at most 'max_pending_views', on overflow the
+     * oldest view is dropped.
+     */
+    void addView (const std_msgs::Header &header, std::vector<HullResult> &hull_results,
+        const ros::Time &cb_start_time,
+        const transparent_object_reconstruction::CompactHoles *embedded_transforms = NULL)
+    {
       // check for bag loop
       static bag_loop_check::BagLoopCheck bagloop;
-      if (bagloop && collected_views_.size () > 0)
+      if (bagloop && (collected_views_.size () > 0 || !pending_views_.empty ()))
       {
         ROS_INFO ("Detected bag loop; Reseting HoleIntersector");
         transparent_object_reconstruction::HoleIntersectorReset::Request req;
@@ -116,77 +278,116 @@ class HoleIntersector
         param_handle_.param<int> ("angle_resolution", angle_resolution_, ANGLE_RESOLUTION);
         param_handle_.param<int> ("opening_angle", opening_angle_, OPENING_ANGLE);
         param_handle_.param<int> ("min_bin_marks", min_bin_marks_, MIN_BIN_MARKS);
+        param_handle_.param<bool> ("incremental_intersection", incremental_, false);
+        param_handle_.param<int> ("nr_hull_threads", nr_hull_threads_, 0);
+        param_handle_.param<int> ("nr_evaluation_threads", nr_evaluation_threads_, 0);
+        setUpThreadPool ();
       }
 
-      ROS_DEBUG ("INTERSECTOR-callback params: angle_resolution_ %i, opening_angle_ %i, min_bin_marks_ %i",
-          angle_resolution_, opening_angle_, min_bin_marks_);
-
-      // since the view was not present so far, add it to the collection
-      collected_views_.push_back (holes->convex_hulls.front ().header);
-      
-      ROS_DEBUG ("added header to collected_views_");
-      ROS_DEBUG ("frame_id: %s, tabletop_frame: %s",
-          holes->convex_hulls.front ().header.frame_id.c_str (),
-          tabletop_frame_.c_str ());
-
-      if (!tflistener_.waitForTransform (holes->convex_hulls.front ().header.frame_id,
-          tabletop_frame_,
-          holes->convex_hulls.front ().header.stamp, ros::Duration (10.0)))
+      if (embedded_transforms != NULL)
       {
-        ROS_ERROR ("Didn't retrieve a transfrom between %s and %s",
-            holes->convex_hulls.front ().header.frame_id.c_str (),
-            tabletop_frame_.c_str ());
-        return;
+        tf::StampedTransform sensor_to_table;
+        if (getEmbeddedTransforms (*embedded_transforms, sensor_to_table))
+        {
+          integrateHoles (header, hull_results, cb_start_time, sensor_to_table);
+          nr_processed_views_++;
+          publishQueueStatus ();
+          return;
+        }
+        ROS_WARN ("No valid embedded transforms for the view from %s at %lf, waiting for tf instead",
+            header.frame_id.c_str (), header.stamp.toSec ());
+        nr_embedded_fallbacks_++;
       }
-      tf::StampedTransform tf_transform;
-
-      ROS_DEBUG ("finished wait for transform");
 
-      try
-      {
-        // retrieve transformation
-        tflistener_.lookupTransform (tabletop_frame_,
-            holes->convex_hulls[0].header.frame_id,
-            holes->convex_hulls[0].header.stamp,
-            tf_transform);
-            current_yaw_ = tf::getYaw (tf_transform.getRotation ());
-      }
-      catch (tf::TransformException &ex)
+      pending_views_.push_back (PendingView ());
+      pending_views_.back ().header = header;
+      pending_views_.back ().hull_results.swap (hull_results);
+      pending_views_.back ().received = cb_start_time;
+      if (pending_views_.size () > static_cast<size_t> (std::max (max_pending_views_, 1)))
       {
-        ROS_WARN ("Transform unavailable: %s", ex.what ());
-        return;
+        ROS_WARN ("tf pending queue is full, dropping the view from %s at %lf",
+            pending_views_.front ().header.frame_id.c_str (), pending_views_.front ().header.stamp.toSec ());
+        pending_views_.pop_front ();
+        nr_dropped_overflow_++;
       }
-      ROS_DEBUG ("got transform");
+      processPendingViews ();
+    };
 
-      if (map_frame_.compare (tabletop_frame_) != 0)
+    /* Integrates the queued views in the order of their arrival as long as the transforms
+     * of the oldest one are available. Views that wait longer than 'pending_timeout' are
+     * dropped.
+     */
+    void processPendingViews ()
+    {
+      while (!pending_views_.empty ())
       {
-        if (!tflistener_.waitForTransform (tabletop_frame_, map_frame_,
-              holes->convex_hulls.front ().header.stamp, ros::Duration (50.0)))
+        PendingView &view = pending_views_.front ();
+        tf::StampedTransform sensor_to_table;
+        if (lookupTransforms (view.header, sensor_to_table))
         {
-          ROS_ERROR ("Didn't retrieve a transfrom between '%s' and %s",
-              tabletop_frame_.c_str (),
-              map_frame_.c_str ());
-          return;
+          integrateHoles (view.header, view.hull_results, view.received, sensor_to_table);
+          nr_processed_views_++;
         }
-        ROS_DEBUG ("finished waiting for transform between %s and %s",
-            tabletop_frame_.c_str (),
-            map_frame_.c_str ());
-
-        try
+        else if (ros::Time::now () - view.received > ros::Duration (pending_timeout_))
         {
-          tflistener_.lookupTransform (map_frame_,
-              tabletop_frame_,
-              holes->convex_hulls[0].header.stamp,
-              table_to_map_);
-          tf::transformTFToEigen (table_to_map_, table_to_map_transform_);
+          ROS_WARN ("Didn't retrieve the transforms for the view from %s at %lf within %lf s, dropping it",
+              view.header.frame_id.c_str (), view.header.stamp.toSec (), pending_timeout_);
+          nr_dropped_timeout_++;
         }
-        catch (tf::TransformException &ex)
+        else
         {
-          ROS_WARN ("Transform between %s and %s unavailable: %s",
-              tabletop_frame_.c_str (), map_frame_.c_str (), ex.what ());
-          return;
+          break;
         }
+        pending_views_.pop_front ();
+      }
+      publishQueueStatus ();
+    };
+
+    void retry_pending_cb (const ros::TimerEvent &event)
+    {
+      if (!pending_views_.empty ())
+      {
+        processPendingViews ();
       }
+    };
+
+    void publishQueueStatus ()
+    {
+      transparent_object_reconstruction::TfQueueStatus status;
+      status.header.stamp = ros::Time::now ();
+      status.queue_depth = pending_views_.size ();
+      status.max_queue_depth = std::max (max_pending_views_, 1);
+      status.nr_processed = nr_processed_views_;
+      status.nr_dropped_overflow = nr_dropped_overflow_;
+      status.nr_dropped_timeout = nr_dropped_timeout_;
+      status.nr_embedded_fallbacks = nr_embedded_fallbacks_;
+      tf_queue_status_pub_.publish (status);
+      ROS_DEBUG ("tf pending queue: %lu views, %lu processed, %lu dropped (overflow), %lu dropped (timeout), %lu without embedded transforms",
+          pending_views_.size (), nr_processed_views_, nr_dropped_overflow_, nr_dropped_timeout_,
+          nr_embedded_fallbacks_);
+    };
+
+    /* Adds the holes of a single view (given as decoded convex hulls in the sensor frame
+     * described by 'header') to the collected frusta and recomputes the intersection. The
+     * transforms of the view need to be retrieved before ('sensor_to_table' and, if the
+     * map frame differs from the tabletop frame, 'table_to_map_').
+     */
+    void integrateHoles (const std_msgs::Header &header, std::vector<HullResult> &hull_results,
+        const ros::Time &cb_start_time, const tf::StampedTransform &tf_transform)
+    {
+      ROS_DEBUG ("INTERSECTOR-callback params: angle_resolution_ %i, opening_angle_ %i, min_bin_marks_ %i, incremental_ %s, nr_hull_threads_ %i, nr_evaluation_threads_ %i",
+          angle_resolution_, opening_angle_, min_bin_marks_, incremental_ ? "true" : "false", nr_hull_threads_,
+          nr_evaluation_threads_);
+
+      // since the view was not present so far, add it to the collection
+      collected_views_.push_back (header);
+      
+      ROS_DEBUG ("added header to collected_views_");
+      ROS_DEBUG ("frame_id: %s, tabletop_frame: %s",
+          header.frame_id.c_str (),
+          tabletop_frame_.c_str ());
+
+      current_yaw_ = tf::getYaw (tf_transform.getRotation ());
 
       // retrieve the label for the new points
       // compute the current label from the used orientation
@@ -216,171 +417,94 @@ class HoleIntersector
       Eigen::Vector3d transformed_origin;
       pcl::transformPoint (Eigen::Vector3d::Zero (), transformed_origin, hole_to_tabletop);
 
-      std::vector<LabelCloudPtr> current_holes;
-      current_holes.reserve (holes->convex_hulls.size ());
-
-      // transform all convex hulls point clouds into the table frame (aligned with x-y-plane)
-      for (size_t i = 0; i < holes->convex_hulls.size (); ++i)
+      // sample the inside of all holes (each hull is processed independently)
+      thread_pool_->parallelFor (hull_results.size (), nr_hull_threads_, [&] (size_t i)
       {
-        // convert sensor_msgs::PointCloud2 to PCLPointCloud2 to pcl::PointCloud<T>
-        LabelCloudPtr hole_hull (new LabelCloud);
-        pcl::PCLPointCloud2 pcl_pc2;
-        pcl_conversions::toPCL (holes->convex_hulls[i], pcl_pc2);
-        pcl::console::setVerbosityLevel (pcl::console::L_ALWAYS);
-        pcl::fromPCLPointCloud2 (pcl_pc2, *hole_hull);
-        pcl::console::setVerbosityLevel (pcl::console::L_INFO);
-
-        ROS_DEBUG ("finished conversion, hole hull size: %lu",
-            hole_hull->points.size ());
+        this->sampleHole (hole_to_tabletop, transformed_origin, current_label, hull_results[i]);
+      });
 
-        // ----- sample inside of hole -----
-
-        // transform into table frame (tabletop aligned with x-y-plane)
-        LabelCloudPtr xy_hole_hull (new LabelCloud);
-        pcl::transformPointCloud (*hole_hull, *xy_hole_hull, hole_to_tabletop);
-
-        ROS_DEBUG ("successfully transformed pointcloud, Yay!");
-
-        geometry_msgs::Point tmp_point;
-        tmp_point.x = transformed_origin[0];
-        tmp_point.y = transformed_origin[1];
-        tmp_point.z = transformed_origin[2];
-        if (tesselateConeOfHull<LabelPoint> (xy_hole_hull, basic_frustum_marker_, &tmp_point))
+      // define reference bounding box (hole samples and sensor origin) from the first
+      // received frustum - its minimum is the origin of the voxel grid, this way all
+      // frusta are properly aligned
+      for (size_t i = 0; i < hull_results.size () && !reference_bb_set_; ++i)
+      {
+        if (hull_results[i].xy_hole_sample_cloud->points.size () > 0)
         {
-          basic_frustum_marker_.id = i;
-          frusta_marker_.markers.push_back (basic_frustum_marker_);
+          LabelPoint min_p, max_p;
+          pcl::getMinMax3D (*hull_results[i].xy_hole_sample_cloud, min_p, max_p);
+          min_ref_bb_ = Eigen::Vector3d (min_p.x, min_p.y, min_p.z).cwiseMin (transformed_origin);
+          reference_bb_set_ = true;
         }
+      }
 
-        // create grid for sampling
-        pcl::VoxelGrid<LabelPoint> grid;
-        grid.setSaveLeafLayout (true);
-        grid.setInputCloud (xy_hole_hull);
-        grid.setLeafSize (0.005f, 0.005f, 1.0f); // TODO: make adaptable
-        grid.setDownsampleAllData (false);
-        grid.setMinimumPointsNumberPerVoxel (1);
-        grid.setFilterLimitsNegative (true);
-
-        ROS_DEBUG ("VoxelGrid created");
-
-        LabelCloudPtr inliers (new LabelCloud);
-        grid.filter (*inliers);
-
-        // retrieve the hull in terms of 2D grid coordinates
-        std::vector<Eigen::Vector2i> hull_polygon;
-        hull_polygon.reserve (xy_hole_hull->points.size ());
-        LabelCloud::VectorType::const_iterator h_it = xy_hole_hull->points.begin ();
-        Eigen::Vector3i grid_coords, bbox_min, bbox_max;
-        Eigen::Vector2i query_point;
-        while (h_it != xy_hole_hull->points.end ())
+      // ----- rasterize frusta -----
+      // walk the voxel grid along the rays from the hole samples to the sensor origin,
+      // this way the (dense) sampled frustum never needs to be created
+      thread_pool_->parallelFor (hull_results.size (), nr_hull_threads_, [&] (size_t i)
+      {
+        if (hull_results[i].xy_hole_sample_cloud->points.size () > 0)
         {
-          grid_coords = grid.getGridCoordinates (h_it->x, h_it->y, h_it->z);
-          hull_polygon.push_back (Eigen::Vector2i (grid_coords[0], grid_coords[1]));
-          h_it++;
+          rasterizeFrustumVoxels (hull_results[i].xy_hole_sample_cloud, transformed_origin.cast<float> (),
+              min_ref_bb_.cast<float> (), octree_resolution_, hull_results[i].frustum_voxels);
+          ROS_DEBUG ("rasterized frustum %lu, nr of voxels: %lu", i, hull_results[i].frustum_voxels.size ());
         }
+      });
 
-        ROS_DEBUG ("retrieved grid coords, nr_grid cells: %lu", hull_polygon.size ());
-
-        // get lower and upper corners of VoxelGrid
-        bbox_min = grid.getMinBoxCoordinates ();
-        bbox_max = grid.getMaxBoxCoordinates ();
-
-        // get all grid coordinates that are inside the 2D polygon to create the sampled hole
-        Eigen::Vector3f leaf_size = grid.getLeafSize ();
-        LabelPoint inside_point;
-        inside_point.z = 0.0f;
-        inside_point.label = current_label;
-        LabelCloudPtr xy_hole_sample_cloud (new LabelCloud);
-        xy_hole_sample_cloud->points.reserve ((bbox_max[0] - bbox_min[0]) * (bbox_max[1] - bbox_min[1]));
-        for (int u = bbox_min[0]; u < bbox_max[0]; ++u)
+      // merge the results of all holes in the order of the convex hulls
+      std::vector<LabelCloudPtr> current_holes;
+      current_holes.reserve (hull_results.size ());
+      // collect the voxels that are traversed by the frusta of the current view
+      VoxelKeySet touched_voxels;
+      for (size_t i = 0; i < hull_results.size (); ++i)
+      {
+        HullResult &result = hull_results[i];
+        if (result.has_frustum_marker)
         {
-          query_point[0] = u;
-          inside_point.x = (u + .5f) * leaf_size[0];
-          for (int v = bbox_min[1]; v < bbox_max[1]; ++v)
-          {
-            query_point[1] = v;
-            if (pointInPolygon2D (hull_polygon, query_point))
-            {
-              inside_point.y = (v + .5f) * leaf_size[1];
-              xy_hole_sample_cloud->points.push_back (inside_point);
-            }
-          }
+          result.frustum_marker.id = i;
+          frusta_marker_.markers.push_back (result.frustum_marker);
         }
 
-        ROS_DEBUG ("created hole sample in x_y_plane, size: %lu, dims: %ix%i",
-            xy_hole_sample_cloud->points.size (), bbox_max[0] - bbox_min[0], bbox_max[1] - bbox_min[1]);
-        
         // store the convex hull in the tabletop frame (with point labels)
-        current_holes.push_back (xy_hole_sample_cloud);
+        current_holes.push_back (result.xy_hole_sample_cloud);
         // store the transform
         transforms_.push_back (hole_to_tabletop);
 
-        // transform sampled hole back into its original frame (where sensor is placed at (0,0,0))
-        LabelCloudPtr hole_sample_cloud (new LabelCloud);
-        pcl::transformPointCloud (*xy_hole_sample_cloud, *hole_sample_cloud, hole_to_tabletop.inverse ());
-
-        // ----- create frustum -----
-        LabelCloudPtr frustum (new LabelCloud);
-        createSampleRays (hole_sample_cloud, frustum, leaf_size[0]);
-        ROS_DEBUG ("created frustum, size: %lu", frustum->points.size ());
-        frustum->header = hole_sample_cloud->header;
-
-        if (frustum->points.size () > 0)
+        if (result.xy_hole_sample_cloud->points.size () > 0)
         {
           // add currently used label to the set of available labels
           available_labels_.insert (current_label);
-          // transform frustum into global frame
-          LabelCloudPtr transformed_frustum (new LabelCloud);
-          pcl::transformPointCloud (*frustum, *transformed_frustum, hole_to_tabletop);
 
-          // define reference bounding box from the first received frustum - this way
-          // all octrees should be properly aligned
-          if (!reference_bb_set_)
+          // add the current label to the voxels occupied by the frustum
+          std::vector<Eigen::Vector3i>::const_iterator voxel_it = result.frustum_voxels.begin ();
+          while (voxel_it != result.frustum_voxels.end ())
           {
-            LabelPoint min_p, max_p;
-            pcl::getMinMax3D (*transformed_frustum, min_p, max_p);
-            min_ref_bb_ = Eigen::Vector3d (min_p.x, min_p.y, min_p.z);
-            max_ref_bb_ = Eigen::Vector3d (max_p.x, max_p.y, max_p.z);
-            reference_bb_set_ = true;
-          }
-
-          // create a downsampled version of the transformed frustum -- so that the overall
-          // point cloud is less dense and checks of individual leafs become much faster
-          // pcl::VoxelGrid unfortunately produces some strange gaps - therefore octree is used for voxelization
-          LabelCloudPtr v_trans_frustum (new LabelCloud);
-          LabelOctree::Ptr voxelize_tree (new LabelOctree (octree_resolution_));
-          // set reference bounding box
-          voxelize_tree->defineBoundingBox (min_ref_bb_[0], min_ref_bb_[1], min_ref_bb_[2],
-          max_ref_bb_[0], max_ref_bb_[1], max_ref_bb_[2]);
-
-          voxelize_tree->setInputCloud (transformed_frustum);
-          voxelize_tree->addPointsFromInputCloud ();
-          voxelize_tree->getOccupiedVoxelCenters (v_trans_frustum->points);
-
-          // add the current label to the points representing leaf center points
-          LabelCloud::VectorType::iterator v_trans_frustum_it = v_trans_frustum->points.begin ();
-          while (v_trans_frustum_it != v_trans_frustum->points.end ())
-          {
-            v_trans_frustum_it->label = current_label;
-            v_trans_frustum_it++;
+            VoxelLeaf &leaf = voxel_leaves_[*voxel_it];
+            if (leaf.label_mask.empty ())
+            {
+              initViewpointMask (leaf.label_mask, angle_resolution_);
+            }
+            setViewpointMaskLabel (leaf.label_mask, current_label, angle_resolution_);
+            // 'frustum_voxels' holds each voxel of the frustum once
+            leaf.nr_frusta++;
+            touched_voxels.insert (*voxel_it);
+            voxel_it++;
           }
-
-          // add frustum to collection of all frusta
-          all_frusta_->points.reserve (all_frusta_->points.size () +
-              transformed_frustum->points.size ());
-          all_frusta_->points.insert (all_frusta_->points.end (),
-              v_trans_frustum->points.begin (), v_trans_frustum->points.end ());
-          // adapt dimensions of point cloud
-          all_frusta_->width = all_frusta_->points.size ();
-          all_frusta_->height = 1;
-          ROS_DEBUG ("inserted frustum points into all_frusta_");
         }
       }
+      ROS_DEBUG ("inserted frusta into voxel map, now %lu occupied voxels", voxel_leaves_.size ());
       // store all convex hulls of the current Holes msgs (aligned to tabletop)
       transformed_holes_.push_back (current_holes);
 
       ros::Time before_intersec_time = ros::Time::now ();
       // compute intersection
-      this->computeIntersection ();
+      if (incremental_)
+      {
+        this->computeIncrementalIntersection (touched_voxels);
+      }
+      else
+      {
+        this->computeIntersection ();
+      }
       ros::Time finished_intersec_time = ros::Time::now ();
 
       ros::Duration cb_duration = finished_intersec_time - cb_start_time;
@@ -392,79 +516,404 @@ class HoleIntersector
       ROS_INFO ("Finished callback, intersections and visualization for %lu views are computed", collected_views_.size ());
     };
 
-    void computeIntersection (void)
+    /* Retrieves the transform from the sensor frame of 'header' into the tabletop frame
+     * and (if different) from the tabletop frame into the map frame via tf. Doesn't wait,
+     * returns false if a transform is not available (yet).
+     */
+    bool lookupTransforms (const std_msgs::Header &header, tf::StampedTransform &sensor_to_table)
     {
-      // remove lingering contents of output clouds
-      intersec_cloud_->points.clear ();
+      std::string error_msg;
+      if (!tflistener_.canTransform (tabletop_frame_, header.frame_id, header.stamp, &error_msg))
+      {
+        ROS_DEBUG ("Transform between %s and %s not available yet: %s",
+            header.frame_id.c_str (), tabletop_frame_.c_str (), error_msg.c_str ());
+        return false;
+      }
+      if (map_frame_.compare (tabletop_frame_) != 0 &&
+          !tflistener_.canTransform (map_frame_, tabletop_frame_, header.stamp, &error_msg))
+      {
+        ROS_DEBUG ("Transform between %s and %s not available yet: %s",
+            tabletop_frame_.c_str (), map_frame_.c_str (), error_msg.c_str ());
+        return false;
+      }
+
+      try
+      {
+        // retrieve transformation
+        tflistener_.lookupTransform (tabletop_frame_,
+            header.frame_id,
+            header.stamp,
+            sensor_to_table);
+        if (map_frame_.compare (tabletop_frame_) != 0)
+        {
+          tflistener_.lookupTransform (map_frame_,
+              tabletop_frame_,
+              header.stamp,
+              table_to_map_);
+          tf::transformTFToEigen (table_to_map_, table_to_map_transform_);
+        }
+      }
+      catch (tf::TransformException &ex)
+      {
+        ROS_WARN ("Transform unavailable: %s", ex.what ());
+        return false;
+      }
+      ROS_DEBUG ("got transforms");
+      return true;
+    };
+
+    /* Retrieves the transform from the sensor frame into the tabletop frame and (if
+     * different) from the tabletop frame into the map frame from the transforms that were
+     * embedded into the holes message by the detector, thus never blocks. Returns false
+     * if the transforms are missing (the detector couldn't retrieve them) or don't match
+     * the frames of the intersector.
+     */
+    bool getEmbeddedTransforms (const transparent_object_reconstruction::CompactHoles &holes,
+        tf::StampedTransform &sensor_to_table)
+    {
+      if (holes.sensor_to_table.header.frame_id.compare (tabletop_frame_) != 0 ||
+          holes.sensor_to_table.child_frame_id.compare (holes.header.frame_id) != 0)
+      {
+        ROS_DEBUG ("Embedded transform from '%s' to '%s' is missing or doesn't match the required transform from '%s' to '%s'",
+            holes.sensor_to_table.child_frame_id.c_str (), holes.sensor_to_table.header.frame_id.c_str (),
+            holes.header.frame_id.c_str (), tabletop_frame_.c_str ());
+        return false;
+      }
+      tf::transformStampedMsgToTF (holes.sensor_to_table, sensor_to_table);
 
+      if (map_frame_.compare (tabletop_frame_) != 0)
+      {
+        if (holes.table_to_map.header.frame_id.compare (map_frame_) != 0 ||
+            holes.table_to_map.child_frame_id.compare (tabletop_frame_) != 0)
+        {
+          ROS_DEBUG ("Embedded transform from '%s' to '%s' is missing or doesn't match the required transform from '%s' to '%s'",
+              holes.table_to_map.child_frame_id.c_str (), holes.table_to_map.header.frame_id.c_str (),
+              tabletop_frame_.c_str (), map_frame_.c_str ());
+          return false;
+        }
+        tf::transformStampedMsgToTF (holes.table_to_map, table_to_map_);
+        tf::transformTFToEigen (table_to_map_, table_to_map_transform_);
+      }
+      return true;
+    };
+
+    /* Samples the inside of a single hole in the table frame (aligned with the
+     * x-y-plane) and creates the visualization marker of its frustum. Only the
+     * given result is modified, so that holes can be processed in parallel.
+     *
+     * @param[in] hole_to_tabletop The transformation from sensor to table frame
+     * @param[in] transformed_origin The sensor position in the table frame
+     * @param[in] current_label The label of the current view
+     * @param[in,out] result The hole (with decoded hull) that is processed
+     */
+    void sampleHole (const Eigen::Affine3d &hole_to_tabletop,
+        const Eigen::Vector3d &transformed_origin, uint32_t current_label,
+        HullResult &result)
+    {
+      // ----- sample inside of hole -----
+
+      // transform into table frame (tabletop aligned with x-y-plane)
+      LabelCloudPtr xy_hole_hull (new LabelCloud);
+      pcl::transformPointCloud (*result.hole_hull, *xy_hole_hull, hole_to_tabletop);
+
+      ROS_DEBUG ("successfully transformed pointcloud, Yay!");
+
+      geometry_msgs::Point tmp_point;
+      tmp_point.x = transformed_origin[0];
+      tmp_point.y = transformed_origin[1];
+      tmp_point.z = transformed_origin[2];
+      result.frustum_marker = basic_frustum_marker_;
+      result.has_frustum_marker = tesselateConeOfHull<LabelPoint> (xy_hole_hull,
+          result.frustum_marker, &tmp_point);
+
+      // create grid for sampling
+      pcl::VoxelGrid<LabelPoint> grid;
+      grid.setSaveLeafLayout (true);
+      grid.setInputCloud (xy_hole_hull);
+      grid.setLeafSize (0.005f, 0.005f, 1.0f); // TODO: make adaptable
+      grid.setDownsampleAllData (false);
+      grid.setMinimumPointsNumberPerVoxel (1);
+      grid.setFilterLimitsNegative (true);
+
+      ROS_DEBUG ("VoxelGrid created");
+
+      LabelCloudPtr inliers (new LabelCloud);
+      grid.filter (*inliers);
+
+      // retrieve the hull in terms of 2D grid coordinates
+      std::vector<Eigen::Vector2i> hull_polygon;
+      hull_polygon.reserve (xy_hole_hull->points.size ());
+      LabelCloud::VectorType::const_iterator h_it = xy_hole_hull->points.begin ();
+      Eigen::Vector3i grid_coords, bbox_min, bbox_max;
+      while (h_it != xy_hole_hull->points.end ())
+      {
+        grid_coords = grid.getGridCoordinates (h_it->x, h_it->y, h_it->z);
+        hull_polygon.push_back (Eigen::Vector2i (grid_coords[0], grid_coords[1]));
+        h_it++;
+      }
+
+      ROS_DEBUG ("retrieved grid coords, nr_grid cells: %lu", hull_polygon.size ());
+
+      // get lower and upper corners of VoxelGrid
+      bbox_min = grid.getMinBoxCoordinates ();
+      bbox_max = grid.getMaxBoxCoordinates ();
+
+      // get all grid coordinates that are inside the 2D polygon (row by row) to create the sampled hole
+      Eigen::Vector3f leaf_size = grid.getLeafSize ();
+      LabelPoint inside_point;
+      inside_point.z = 0.0f;
+      inside_point.label = current_label;
+      result.xy_hole_sample_cloud = boost::make_shared<LabelCloud> ();
+      LabelCloudPtr &xy_hole_sample_cloud = result.xy_hole_sample_cloud;
+      xy_hole_sample_cloud->points.reserve ((bbox_max[0] - bbox_min[0]) * (bbox_max[1] - bbox_min[1]));
+      std::vector<Eigen::Vector3i> spans;
+      polygonScanlineSpans2D (hull_polygon, spans);
+      std::vector<Eigen::Vector3i>::const_iterator span_it = spans.begin ();
+      while (span_it != spans.end ())
+      {
+        int v = (*span_it)[0];
+        if (v >= bbox_min[1] && v < bbox_max[1])
+        {
+          inside_point.y = (v + .5f) * leaf_size[1];
+          int u_end = std::min ((*span_it)[2] + 1, bbox_max[0]);
+          for (int u = std::max ((*span_it)[1], bbox_min[0]); u < u_end; ++u)
+          {
+            inside_point.x = (u + .5f) * leaf_size[0];
+            xy_hole_sample_cloud->points.push_back (inside_point);
+          }
+        }
+        span_it++;
+      }
+
+      ROS_DEBUG ("created hole sample in x_y_plane, size: %lu, dims: %ix%i",
+          xy_hole_sample_cloud->points.size (), bbox_max[0] - bbox_min[0], bbox_max[1] - bbox_min[1]);
+    };
+
+    /* Evaluates all occupied voxels of the persistent voxel map, determines
+     * which of them belong to the intersection and publishes the result.
+     */
+    void computeIntersection (void)
+    {
       if (available_labels_.size () < 1)
       {
         ROS_WARN ("called 'computeIntersection ()', but no label exists; Exiting intersection computation");
         return;
       }
-      // clear old content from octree and intersection cloud
-      octree_->deleteTree ();
-      octree_->defineBoundingBox (min_ref_bb_[0], min_ref_bb_[1], min_ref_bb_[2],
-          max_ref_bb_[0], max_ref_bb_[1], max_ref_bb_[2]);
-      octree_->setInputCloud (all_frusta_);
-      octree_->addPointsFromInputCloud ();
-
-      // iterate over all leafs and check which are filled with points of all labels
-      LabelOctree::LeafNodeIterator leaf_it;
-      leaf_it = octree_->leaf_begin ();
-      pcl::PointIndices::Ptr leaf_point_indices (new pcl::PointIndices);
-      LabelCloudPtr leaf_cloud (new LabelCloud);
-      pcl::ExtractIndices<LabelPoint> extract;
-      extract.setInputCloud (all_frusta_);
-
-      // get nr occupied voxels
-      // TODO: check if there is a more efficient way to do this
-      LabelCloud::VectorType leaf_centers;
-      LabelCloud::VectorType::const_iterator p_it;
-      octree_->getOccupiedVoxelCenters (leaf_centers);
 
-      // clear old contents from message markers
+      // check for all leaves which belongs to the intersection
+      std::vector<VoxelLeaf*> leaves;
+      leaves.reserve (voxel_leaves_.size ());
+      VoxelLeafMap::iterator leaf_it = voxel_leaves_.begin ();
+      while (leaf_it != voxel_leaves_.end ())
+      {
+        leaves.push_back (&(leaf_it++)->second);
+      }
+      this->evaluateVoxelLeaves (leaves);
+
+      this->collectIntersection ();
+      if (intersec_cloud_->points.size () > 0)
+      {
+        this->publish_intersec ();
+      }
+
+      this->publish_voxel_markers ();
+      this->publish_markers ();
+    };
+
+    /* Incremental counterpart of 'computeIntersection ()'. Only the voxels that
+     * received new frustum points by the current view are re-evaluated, all
+     * other voxels keep the result of their last evaluation. Since the labels
+     * in a voxel only ever grow, a voxel that was part of the intersection
+     * stays part of it; the re-evaluated voxels that belong to the intersection
+     * are published as a delta message. Thus the cost only depends on the number
+     * of touched voxels, the complete intersection (cloud, 'VoxelizedTransObjInfo'
+     * and voxel markers) is collected and published by 'publish_full_cb ()' at
+     * most once per 'full_publish_period'.
+     *
+     * @param[in] touched_voxels The keys of the voxels that received new points
+     */
+    void computeIncrementalIntersection (const VoxelKeySet &touched_voxels)
+    {
+      if (available_labels_.size () < 1)
+      {
+        ROS_WARN ("called 'computeIncrementalIntersection ()', but no label exists; Exiting intersection computation");
+        return;
+      }
+
+      // re-evaluate the touched voxels only
+      std::vector<VoxelLeaf*> leaves;
+      leaves.reserve (touched_voxels.size ());
+      VoxelKeySet::const_iterator key_it = touched_voxels.begin ();
+      while (key_it != touched_voxels.end ())
+      {
+        leaves.push_back (&voxel_leaves_[*key_it++]);
+      }
+      this->evaluateVoxelLeaves (leaves);
+
+      LabelCloudPtr delta_centers (new LabelCloud);
+      std::vector<std::vector<uint32_t> > delta_labels;
+      std::vector<transparent_object_reconstruction::VoxelViewPointIntervals> delta_vp_intervals;
+      delta_centers->points.reserve (touched_voxels.size ());
+      delta_labels.reserve (touched_voxels.size ());
+      delta_vp_intervals.reserve (touched_voxels.size ());
+
+      // gather the re-evaluated voxels that are part of the intersection
+      key_it = touched_voxels.begin ();
+      for (size_t i = 0; i < leaves.size (); ++i, ++key_it)
+      {
+        const VoxelLeaf &leaf = *leaves[i];
+        if (leaf.in_intersection)
+        {
+          delta_centers->points.push_back (convert<LabelPoint, Eigen::Vector3f> (getVoxelCenter (*key_it)));
+          delta_centers->points.rbegin ()->label = leaf.nr_vp_marks;
+          delta_labels.resize (delta_labels.size () + 1);
+          convertViewpointMask2LabelVector (leaf.label_mask, delta_labels.back ());
+          delta_vp_intervals.resize (delta_vp_intervals.size () + 1);
+          convertViewpointMask2VoxelViewpointIntervals (leaf.vp_mask, angle_resolution_,
+              delta_vp_intervals.back ());
+        }
+      }
+      ROS_DEBUG ("re-evaluated %lu of %lu voxels, %lu are part of the intersection",
+          touched_voxels.size (), voxel_leaves_.size (), delta_centers->points.size ());
+
+      if (delta_centers->points.size () > 0)
+      {
+        transparent_object_reconstruction::VoxelizedTransObjInfo delta_info;
+        this->createTransObjInfo (delta_centers, delta_labels, delta_vp_intervals, delta_info);
+        trans_obj_info_delta_pub_.publish (delta_info);
+      }
+      full_state_outdated_ = true;
+
+      this->publish_markers ();
+    };
+
+    /* Collects and publishes the complete intersection of the incremental mode if
+     * views were integrated since the last time.
+     */
+    void publish_full_cb (const ros::TimerEvent &event)
+    {
+      if (!incremental_ || !full_state_outdated_)
+        return;
+
+      this->collectIntersection ();
+      if (intersec_cloud_->points.size () > 0)
+      {
+        this->publish_intersec ();
+      }
+      this->publish_voxel_markers ();
+      full_state_outdated_ = false;
+    };
+
+    /* Evaluates a single voxel, i.e., checks if it is traversed by enough hole
+     * frusta and if so, if it is part of the intersection. The results are cached
+     * in the voxel.
+     *
+     * @param[in,out] leaf The voxel that is evaluated
+     * @returns true, if the voxel is part of the intersection, false otherwise
+     */
+    bool evaluateVoxelLeaf (VoxelLeaf &leaf)
+    {
+      // check if enough frusta traverse the leaf
+      leaf.filled = (leaf.nr_frusta >= min_leaf_points_);
+      leaf.in_intersection = leaf.filled &&
+        isLeafInIntersectionViewPoint (leaf.label_mask, leaf.nr_frusta, leaf.vp_mask, leaf.nr_vp_marks);
+      return leaf.in_intersection;
+    };
+
+    /* Evaluates the given voxels via 'evaluateVoxelLeaf ()'. Contiguous chunks of
+     * voxels are evaluated in parallel; since each voxel is only modified by the
+     * thread that evaluates it, the result is independent of the number of threads.
+     *
+     * @param[in] leaves The voxels that are evaluated
+     */
+    void evaluateVoxelLeaves (const std::vector<VoxelLeaf*> &leaves)
+    {
+      size_t nr_chunks = (leaves.size () + VOXEL_CHUNK_SIZE - 1) / VOXEL_CHUNK_SIZE;
+      thread_pool_->parallelFor (nr_chunks, nr_evaluation_threads_, [&] (size_t chunk)
+      {
+        size_t end = std::min (leaves.size (), (chunk + 1) * VOXEL_CHUNK_SIZE);
+        for (size_t i = chunk * VOXEL_CHUNK_SIZE; i < end; ++i)
+        {
+          evaluateVoxelLeaf (*leaves[i]);
+        }
+      });
+    };
+
+    /* Gathers the cached evaluation results of all voxels into the output clouds,
+     * markers and per voxel labels / viewpoint intervals. The intersection cloud
+     * contains one point (at the voxel center) per label present in a voxel.
+     * Contiguous ranges of voxels are collected in parallel into separate slabs,
+     * which are concatenated in the order of the voxels, so the output is identical
+     * to a serial collection.
+     */
+    void collectIntersection (void)
+    {
+      std::vector<VoxelLeafMap::const_iterator> leaves;
+      leaves.reserve (voxel_leaves_.size ());
+      VoxelLeafMap::const_iterator leaf_it = voxel_leaves_.begin ();
+      while (leaf_it != voxel_leaves_.end ())
+      {
+        leaves.push_back (leaf_it++);
+      }
+
+      size_t nr_chunks = (leaves.size () + VOXEL_CHUNK_SIZE - 1) / VOXEL_CHUNK_SIZE;
+      std::vector<IntersectionSlab> slabs (nr_chunks);
+      thread_pool_->parallelFor (nr_chunks, nr_evaluation_threads_, [&] (size_t chunk)
+      {
+        size_t end = std::min (leaves.size (), (chunk + 1) * VOXEL_CHUNK_SIZE);
+        this->collectVoxelRange (leaves, chunk * VOXEL_CHUNK_SIZE, end, slabs[chunk]);
+      });
+
+      // clear old contents from output clouds and message markers
+      intersec_cloud_->points.clear ();
       intersec_marker_.points.clear ();
       non_intersec_marker_.points.clear ();
-      intersec_marker_.points.reserve (leaf_centers.size ());
-      non_intersec_marker_.points.reserve (leaf_centers.size ());
-
-      // prepare storage for additional outputs
       voxelized_intersec_cloud_->points.clear ();
       voxel_labels_.clear ();
       voxel_vp_intervals_.clear ();
-      voxelized_intersec_cloud_->points.reserve (leaf_centers.size ());
-      voxel_labels_.reserve (leaf_centers.size ());
-      voxel_vp_intervals_.reserve (leaf_centers.size ());
-
-      // iterate over all leaves to check which belongs to the intersection
-      intersec_cloud_->points.reserve (all_frusta_->points.size ());
-      size_t nr_leaves, filled_leaves, intersec_leaves;
-      nr_leaves = filled_leaves = intersec_leaves = 0;
-      Eigen::Vector3f min, max, center;
+
+      // concatenate the slabs
+      std::vector<IntersectionSlab>::iterator slab_it = slabs.begin ();
+      while (slab_it != slabs.end ())
+      {
+        intersec_cloud_->points.insert (intersec_cloud_->points.end (),
+            slab_it->intersec_points.begin (), slab_it->intersec_points.end ());
+        intersec_marker_.points.insert (intersec_marker_.points.end (),
+            slab_it->intersec_marker_points.begin (), slab_it->intersec_marker_points.end ());
+        non_intersec_marker_.points.insert (non_intersec_marker_.points.end (),
+            slab_it->non_intersec_marker_points.begin (), slab_it->non_intersec_marker_points.end ());
+        voxelized_intersec_cloud_->points.insert (voxelized_intersec_cloud_->points.end (),
+            slab_it->voxel_centers.begin (), slab_it->voxel_centers.end ());
+        voxel_labels_.insert (voxel_labels_.end (),
+            slab_it->voxel_labels.begin (), slab_it->voxel_labels.end ());
+        voxel_vp_intervals_.insert (voxel_vp_intervals_.end (),
+            slab_it->voxel_vp_intervals.begin (), slab_it->voxel_vp_intervals.end ());
+        slab_it++;
+      }
+    };
+
+    /* Collects the cached evaluation results of the voxels leaves[begin] to
+     * leaves[end - 1] into the given slab (see 'collectIntersection ()').
+     *
+     * @param[in] leaves The voxels (in map order)
+     * @param[in] begin The index of the first voxel that is collected
+     * @param[in] end The index after the last voxel that is collected
+     * @param[out] slab The collected output of the voxel range
+     */
+    void collectVoxelRange (const std::vector<VoxelLeafMap::const_iterator> &leaves,
+        size_t begin, size_t end, IntersectionSlab &slab) const
+    {
+      Eigen::Vector3f center;
       Eigen::Vector3d center_double;
       geometry_msgs::Point voxel_center;
-      while (leaf_it != octree_->leaf_end ())
+      LabelPoint label_point;
+      for (size_t i = begin; i < end; ++i)
       {
-        nr_leaves++;
-        // remove old point indices
-        leaf_point_indices->indices.clear ();
-
-        // retrieve container for the current leaf
-        LeafContainer &container = leaf_it.getLeafContainer ();
-        container.getPointIndices (leaf_point_indices->indices);
-
-        // check if enough points in leaf
-        if (leaf_point_indices->indices.size () >= min_leaf_points_)
+        const VoxelLeaf &leaf = leaves[i]->second;
+        if (leaf.filled)
         {
-          filled_leaves++;
-          extract.setIndices (leaf_point_indices);
-          extract.filter (*leaf_cloud);
-
           // retrieve the center point of the current leaf
-          octree_->getVoxelBounds (leaf_it, min, max);
-          center = min + max;
-          center /= 2.0f;
+          center = getVoxelCenter (leaves[i]->first);
           // transform center from tabletop to map frame
           center_double = Eigen::Vector3d (center[0], center[1], center[2]);
           center_double = table_to_map_transform_ * center_double;
@@ -472,35 +921,33 @@ class HoleIntersector
           voxel_center.y = center_double[1];
           voxel_center.z = center_double[2];
 
-          bool detected_fraction;
-          std::vector<uint32_t> leaf_labels_vec;
-          boost::icl::interval_set<int> acc_vp_intervals;
-          if (isLeafInIntersectionViewPoint (*leaf_cloud, leaf_labels_vec, acc_vp_intervals))
+          if (leaf.in_intersection)
           {
-            intersec_marker_.points.push_back (voxel_center);
-            intersec_leaves++;
-            intersec_cloud_->points.insert (intersec_cloud_->points.end (),
-                leaf_cloud->points.begin (), leaf_cloud->points.end ());
+            slab.intersec_marker_points.push_back (voxel_center);
+            slab.voxel_labels.resize (slab.voxel_labels.size () + 1);
+            std::vector<uint32_t> &leaf_labels = slab.voxel_labels.back ();
+            convertViewpointMask2LabelVector (leaf.label_mask, leaf_labels);
+            label_point = convert<LabelPoint, Eigen::Vector3f> (center);
+            std::vector<uint32_t>::const_iterator label_it = leaf_labels.begin ();
+            while (label_it != leaf_labels.end ())
+            {
+              label_point.label = *label_it++;
+              slab.intersec_points.push_back (label_point);
+            }
 
             // add voxel_center to voxelized_intersec_cloud_
-            voxelized_intersec_cloud_->points.push_back (convert<LabelPoint, Eigen::Vector3f> (center));
-            voxelized_intersec_cloud_->points.rbegin ()->label = acc_vp_intervals.size ();
-            voxel_labels_.push_back (leaf_labels_vec);
-            voxel_vp_intervals_.push_back (acc_vp_intervals);
+            slab.voxel_centers.push_back (convert<LabelPoint, Eigen::Vector3f> (center));
+            slab.voxel_centers.rbegin ()->label = leaf.nr_vp_marks;
+            slab.voxel_vp_intervals.resize (slab.voxel_vp_intervals.size () + 1);
+            convertViewpointMask2VoxelViewpointIntervals (leaf.vp_mask, angle_resolution_,
+                slab.voxel_vp_intervals.back ());
           }
           else
           {
-            non_intersec_marker_.points.push_back (voxel_center);
+            slab.non_intersec_marker_points.push_back (voxel_center);
           }
         }
-        leaf_it++;
-      }
-      if (intersec_cloud_->points.size () > 0)
-      {
-        this->publish_intersec ();
       }
-
-      this->publish_markers ();
     };
 
     void publish_intersec (void)
@@ -516,15 +963,7 @@ class HoleIntersector
         // set width and height of cloud
         intersec_cloud_->height = 1;
         intersec_cloud_->width = intersec_cloud_->points.size ();
-        // set width and height for voxelized cloud
-        voxelized_intersec_cloud_->height = 1;
-        voxelized_intersec_cloud_->width = voxelized_intersec_cloud_->points.size ();
 
-        // create the new message...
-        transparent_object_reconstruction::VoxelizedTransObjInfo trans_obj_info;
-
-        // create temporary PCLPointCloud2 for conversion to ros::sensor_msgs::PointCloud2
-        pcl::PCLPointCloud2 pcl_pc2;
         if (map_frame_.compare (tabletop_frame_) != 0)
         {
           // transform and publish in map frame
@@ -535,38 +974,76 @@ class HoleIntersector
 
           // publish
           intersec_pub_.publish (tmp_cloud);
-
-          // transform voxel centers in map frame
-          LabelCloudPtr voxel_centers_map_frame (new LabelCloud);
-          pcl::transformPointCloud (*voxelized_intersec_cloud_, *voxel_centers_map_frame, table_to_map_transform_);
-          // convert transformed voxel centers to PCLPointCloud2
-          pcl::toPCLPointCloud2<LabelPoint> (*voxel_centers_map_frame, pcl_pc2);
         }
         else
         {
           // publish
           intersec_pub_.publish (intersec_cloud_);
-          pcl::toPCLPointCloud2<LabelPoint> (*voxelized_intersec_cloud_, pcl_pc2);
         }
-        // convert voxel centers to sensor_msgs::PointCloud2
-        pcl_conversions::moveFromPCL (pcl_pc2, trans_obj_info.voxel_centers);
-        // set header information
-        trans_obj_info.voxel_centers.header = header;
 
-        // finish rest of VoxelizedTransObjInfo message
-        // set labels for all voxels
-        convertLabelVectorCollection2VoxelLabelCollection (voxel_labels_, trans_obj_info.voxel_labels);
+        // create and publish the new message
+        transparent_object_reconstruction::VoxelizedTransObjInfo trans_obj_info;
+        this->createTransObjInfo (voxelized_intersec_cloud_, voxel_labels_, voxel_vp_intervals_, trans_obj_info);
+        trans_obj_info_pub_.publish (trans_obj_info);
+      }
+    };
 
-        // set intervals for all voxels
-        convertICLIntervalSetVector2VoxelViewpointIntervalVector (voxel_vp_intervals_,
-            trans_obj_info.voxel_intervals);
+    /* Assembles a 'VoxelizedTransObjInfo' message from the given voxel centers
+     * (in the tabletop frame) and their labels and viewpoint intervals. If the
+     * map frame differs from the tabletop frame the voxel centers are transformed
+     * into the map frame.
+     *
+     * @param[in] voxel_centers The voxel centers in the tabletop frame
+     * @param[in] voxel_labels The labels contained in each voxel
+     * @param[in] voxel_vp_intervals The viewpoint intervals of each voxel
+     * @param[out] trans_obj_info The assembled message
+     */
+    void createTransObjInfo (const LabelCloudPtr &voxel_centers,
+        const std::vector<std::vector<uint32_t> > &voxel_labels,
+        const std::vector<transparent_object_reconstruction::VoxelViewPointIntervals> &voxel_vp_intervals,
+        transparent_object_reconstruction::VoxelizedTransObjInfo &trans_obj_info)
+    {
+      // create Header with appropriate frame and time stamp
+      std_msgs::Header header;
+      header.frame_id = tabletop_frame_;
+      header.stamp = ros::Time::now ();
 
-        // publish the new message
-        trans_obj_info_pub_.publish (trans_obj_info);
+      // set width and height for voxelized cloud
+      voxel_centers->height = 1;
+      voxel_centers->width = voxel_centers->points.size ();
+
+      // create temporary PCLPointCloud2 for conversion to ros::sensor_msgs::PointCloud2
+      pcl::PCLPointCloud2 pcl_pc2;
+      if (map_frame_.compare (tabletop_frame_) != 0)
+      {
+        header.frame_id = map_frame_;
+        // transform voxel centers in map frame
+        LabelCloudPtr voxel_centers_map_frame (new LabelCloud);
+        pcl::transformPointCloud (*voxel_centers, *voxel_centers_map_frame, table_to_map_transform_);
+        // convert transformed voxel centers to PCLPointCloud2
+        pcl::toPCLPointCloud2<LabelPoint> (*voxel_centers_map_frame, pcl_pc2);
+      }
+      else
+      {
+        pcl::toPCLPointCloud2<LabelPoint> (*voxel_centers, pcl_pc2);
       }
+      // convert voxel centers to sensor_msgs::PointCloud2
+      pcl_conversions::moveFromPCL (pcl_pc2, trans_obj_info.voxel_centers);
+      // set header information
+      trans_obj_info.voxel_centers.header = header;
+
+      // finish rest of VoxelizedTransObjInfo message
+      // set labels for all voxels
+      convertLabelVectorCollection2VoxelLabelCollection (voxel_labels, trans_obj_info.voxel_labels);
+
+      // set intervals for all voxels
+      trans_obj_info.voxel_intervals = voxel_vp_intervals;
     };
 
-    void publish_markers (void)
+    /* Publishes the markers of the voxels inside and outside of the intersection, as
+     * gathered by 'collectIntersection ()'.
+     */
+    void publish_voxel_markers (void)
     {
       intersec_marker_.header.stamp = ros::Time::now ();
       non_intersec_marker_.header.stamp = ros::Time::now ();
@@ -579,7 +1056,13 @@ class HoleIntersector
       vis_marker_array.markers.push_back (intersec_marker_);
       vis_marker_array.markers.push_back (non_intersec_marker_);
       vis_pub_.publish (vis_marker_array);
+    };
 
+    /* Publishes the (recolored) markers of the occlusion frusta of all views, needs to
+     * be called once per view.
+     */
+    void publish_markers (void)
+    {
       // recolor and publish Marker array for occlusion frusta
       frame_change_indices.push_back (frusta_marker_.markers.size ());
       float h, r, g, b, color_increment;
@@ -645,15 +1128,14 @@ class HoleIntersector
       // reset collected holes an the transformations to tabletop frame...
       transformed_holes_.clear ();
       transforms_.clear ();
-      // ...reset the combined cloud holding all frusta and the intersection...
-      all_frusta_->points.clear ();
-      all_frusta_->width = all_frusta_->height = 0;
+      // ...reset the intersection...
       intersec_cloud_->points.clear ();
       intersec_cloud_->width = intersec_cloud_->height = 0;
       // ...reset the labes used up until now...
       available_labels_.clear ();
-      // ...reset the collected views...
+      // ...reset the collected and the pending views...
       collected_views_.clear ();
+      pending_views_.clear ();
       // ...reset the markers...
       intersec_marker_.points.clear ();
       non_intersec_marker_.points.clear ();
@@ -663,9 +1145,12 @@ class HoleIntersector
       vis_pub_.publish (clear_marker_array_);
       frusta_marker_.markers.clear ();
       frame_change_indices.clear ();
+      // ...reset the persistent voxels...
+      voxel_leaves_.clear ();
+      full_state_outdated_ = false;
       // reset reference bounding box
       reference_bb_set_ = false;
-      min_ref_bb_ = max_ref_bb_ = Eigen::Vector3d::Zero ();
+      min_ref_bb_ = Eigen::Vector3d::Zero ();
       // ...and exit
       ROS_INFO ("Reset HoleIntersector");
       return true;
@@ -682,16 +1167,48 @@ class HoleIntersector
     int angle_resolution_;
     int opening_angle_;
     int min_bin_marks_;
+    bool incremental_;
+    double full_publish_period_;
+    bool full_state_outdated_;
+    int nr_hull_threads_;
+    int nr_evaluation_threads_;
+    boost::shared_ptr<ThreadPool> thread_pool_;
+    bool compact_holes_;
+    bool use_embedded_transforms_;
 
     bool reference_bb_set_;
     Eigen::Vector3d min_ref_bb_;
-    Eigen::Vector3d max_ref_bb_;
 
     Eigen::Affine3d table_to_map_transform_;
     tf::StampedTransform table_to_map_;
 
     std::set<uint32_t> all_labels_;
 
+    /* (Re)creates the thread pool that processes the hulls and voxels, so that it
+     * provides the larger of the two requested numbers of threads.
+     */
+    void setUpThreadPool (void)
+    {
+      size_t nr_threads = std::max (resolveNrThreads (std::max (nr_hull_threads_, 0)),
+          resolveNrThreads (std::max (nr_evaluation_threads_, 0)));
+      if (!thread_pool_ || thread_pool_->size () != nr_threads)
+      {
+        thread_pool_.reset ();
+        thread_pool_ = boost::make_shared<ThreadPool> (nr_threads);
+      }
+    };
+
+    /* Returns the center point of the voxel with the given key, i.e., the index
+     * of the voxel in the grid that is spanned by the octree resolution, starting
+     * at the minimum of the reference bounding box.
+     */
+    Eigen::Vector3f getVoxelCenter (const Eigen::Vector3i &key) const
+    {
+      return Eigen::Vector3f (min_ref_bb_[0] + (key[0] + .5f) * octree_resolution_,
+          min_ref_bb_[1] + (key[1] + .5f) * octree_resolution_,
+          min_ref_bb_[2] + (key[2] + .5f) * octree_resolution_);
+    };
+
     void setUpVisMarkers (void)
     {
       // set up visualization marker
@@ -748,21 +1265,36 @@ class HoleIntersector
     ros::Publisher intersec_pub_;
     ros::Publisher all_frusta_pub_;
     ros::Publisher trans_obj_info_pub_;
+    ros::Publisher trans_obj_info_delta_pub_;
+
+    ros::Publisher tf_queue_status_pub_;
 
     ros::ServiceServer reset_service_;
 
+    ros::Timer retry_timer_;
+    ros::Timer full_publish_timer_;
+
     tf::TransformListener tflistener_;
     std::vector<std::vector<LabelCloudPtr> > transformed_holes_;
     std::vector<Eigen::Affine3d> transforms_;
 
-    LabelCloudPtr all_frusta_;
     LabelCloudPtr intersec_cloud_;
     LabelCloudPtr voxelized_intersec_cloud_;
     std::vector<std::vector<uint32_t> > voxel_labels_;
-    std::vector<boost::icl::interval_set<int> > voxel_vp_intervals_;
+    std::vector<transparent_object_reconstruction::VoxelViewPointIntervals> voxel_vp_intervals_;
+    VoxelLeafMap voxel_leaves_;
 
     std::set<uint32_t> available_labels_;
     std::vector<std_msgs::Header> collected_views_;
+
+    std::deque<PendingView> pending_views_;
+    int max_pending_views_;
+    double pending_timeout_;
+    size_t nr_processed_views_;
+    size_t nr_dropped_overflow_;
+    size_t nr_dropped_timeout_;
+    size_t nr_embedded_fallbacks_;
+
     std::vector<size_t> frame_change_indices;
 
     visualization_msgs::Marker intersec_marker_;
@@ -771,8 +1303,6 @@ class HoleIntersector
     visualization_msgs::MarkerArray frusta_marker_;
     visualization_msgs::MarkerArray clear_marker_array_;
 
-    LabelOctree::Ptr octree_;
-
     static void addLabelToCloud (LabelCloudPtr &cloud, uint32_t label)
     {
       LabelCloud::VectorType::iterator p_it = cloud->points.begin ();
@@ -833,80 +1363,38 @@ class HoleIntersector
       return false;
     };
 
-    /* Determines if an octree leaf (represented by its points) is possibly part
-     * of a transparent object, depending on the available labels in the leaf.
+    /* Determines if a voxel (represented by the bitset of its labels) is possibly
+     * part of a transparent object, depending on the available labels in the voxel.
      * Labels have to encode the viewing angle between the cameras viewing
      * direction and the coordinate frame of the tabletop.
      *
-     * @param[in] leaf_cloud The points that represent the current octree leaf
+     * The viewpoint coverage is obtained by a circular dilation of the label
+     * bitset by the opening angle.
+     *
+     * @param[in] label_mask The bitset of the labels present in the current voxel
+     * @param[in] nr_frusta The number of hole frusta that traverse the voxel (each
+     *   frustum counted once)
+     * @param[out] vp_mask The bitset of the viewpoints that are covered by the voxel's labels
+     * @param[out] nr_vp_marks The number of covered viewpoints
      * @returns true, if the leaf is considered part of a transparent object, false otherwise
      */
-    bool isLeafInIntersectionViewPoint (const LabelCloud &leaf_cloud,
-        std::vector<uint32_t> &leaf_labels_vec,
-        boost::icl::interval_set<int> &acc_vp_intervals)
+    bool isLeafInIntersectionViewPoint (const ViewpointMask &label_mask, size_t nr_frusta,
+        ViewpointMask &vp_mask, uint32_t &nr_vp_marks)
     {
-      // check if number of points is sufficient
-      if (leaf_cloud.points.size () < (min_bin_marks_ / opening_angle_))
+      // check if the voxel is traversed by enough frusta (i.e. seen as part of a hole
+      // often enough), the threshold has the same meaning as for the former voxelized
+      // frustum clouds, which contained one point per frustum and voxel
+      if (nr_frusta < (min_bin_marks_ / opening_angle_))
       {
         return false;
       }
 
-      // clear output argument
-      acc_vp_intervals.clear ();
-
-      // gather all labels in the point cloud
-      std::set<uint32_t> leaf_labels;
-      LabelCloud::VectorType::const_iterator p_it = leaf_cloud.points.begin ();
-      while (p_it != leaf_cloud.points.end ())
-      {
-        leaf_labels.insert (p_it->label);
-        p_it++;
-      }
-
-      // now generate the viewpoint marker array from the detected labels using intervals
-      std::set<uint32_t>::const_iterator label_it = leaf_labels.begin ();
-      int lower_bound, upper_bound;
-      while (label_it != leaf_labels.end ())
-      {
-        // compute interval limits
-        lower_bound = static_cast<int> (*label_it) - opening_angle_;
-        upper_bound = static_cast<int> (*label_it) + opening_angle_;
-        // add one interval (negative lower bound or upper bound larger than angle_resolution_ are allowed)
-        acc_vp_intervals.insert (boost::icl::construct<boost::icl::discrete_interval<int> >
-            (lower_bound, upper_bound, boost::icl::interval_bounds::closed ()));
-        label_it++;
-      }
-
-      // check if intervals in set need to be normalized
-      if (acc_vp_intervals.begin ()->lower () < 0)
-      {
-        lower_bound = acc_vp_intervals.begin ()->lower ();
-        upper_bound = acc_vp_intervals.begin ()->upper ();
-        acc_vp_intervals.erase (acc_vp_intervals.begin ());
-        acc_vp_intervals.insert (boost::icl::construct<boost::icl::discrete_interval<int> >
-            (0, upper_bound, boost::icl::interval_bounds::closed ()));
-        acc_vp_intervals.insert (boost::icl::construct<boost::icl::discrete_interval<int> >
-            (angle_resolution_ + lower_bound, angle_resolution_ - 1, boost::icl::interval_bounds::closed ()));
-      }
-      boost::icl::interval_set<int>::iterator last_element = acc_vp_intervals.end ();
-      last_element--;
-      if (last_element->upper () >= angle_resolution_)
-      {
-        lower_bound = last_element->lower ();
-        upper_bound = last_element->upper ();
-        acc_vp_intervals.erase (last_element);
-        acc_vp_intervals.insert (boost::icl::construct<boost::icl::discrete_interval<int> >
-            (0, upper_bound - angle_resolution_, boost::icl::interval_bounds::closed ()));
-        acc_vp_intervals.insert (boost::icl::construct<boost::icl::discrete_interval<int> >
-            (lower_bound, angle_resolution_ - 1, boost::icl::interval_bounds::closed ()));
-      }
-
-      // prepare output argument (present leaf labels)
-      std::vector<uint32_t> tmp_leaf_labels_vec (leaf_labels.begin (), leaf_labels.end ());
-      leaf_labels_vec.swap (tmp_leaf_labels_vec);
+      // mark all viewpoints within the opening angle of the present labels
+      dilateViewpointMask (label_mask, angle_resolution_, opening_angle_, vp_mask);
 
       // gather the number of marks in the viewpoint marker
-      if (acc_vp_intervals.size () >= min_bin_marks_)
+      nr_vp_marks = countViewpointMaskLabels (vp_mask);
+      if (nr_vp_marks >= min_bin_marks_)
       {
         return true;
       }
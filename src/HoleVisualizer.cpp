@@ -13,6 +13,7 @@
 
 #include <transparent_object_reconstruction/common_typedefs.h>
 #include <transparent_object_reconstruction/Holes.h>
+#include <transparent_object_reconstruction/CompactHoles.h>
 #include <transparent_object_reconstruction/tools.h>
 
 ros::Publisher vis_pub;
@@ -20,50 +21,74 @@ ros::Publisher vis_pub;
 visualization_msgs::Marker marker;
 
 
+/* Removes the markers of the previous holes.
+ */
 void
-hole_hull_cb (const transparent_object_reconstruction::Holes::ConstPtr &holes)
+clear_hole_markers ()
 {
-  ROS_DEBUG ("Retrieved a total of %lu convex hulls", holes->convex_hulls.size ());
-
   visualization_msgs::Marker clear_marker(marker);
   // prevent RViz warning about empty frame_id
   clear_marker.header.frame_id = "map";
   // DELETEALL is not officially around before jade, addressed it by value
   clear_marker.action = 3;
   vis_pub.publish (clear_marker);
+}
 
-  if (holes->convex_hulls.size () == 0)
-    return;
+/* Publishes the tesselated convex hull of a hole with a color that depends on the index
+ * of the hole (rainbow colors over all 'nr_holes' holes).
+ */
+void
+publish_hole_marker (const CloudPtr &hull_cloud, const std_msgs::Header &header,
+    size_t hole_index, size_t nr_holes)
+{
+  float r,g,b;
+  float color_increment = 360.f / static_cast<float>(nr_holes);
+
+  // set up header etc. for marker
+  visualization_msgs::Marker tmp_marker (marker);
+  tmp_marker.id = hole_index;
+  tmp_marker.header = header;
+  // assign marker with rainbow color, dependent on number of markers in holes msg
+  hsv2rgb (hole_index * color_increment, r, g, b);
+  tmp_marker.color.r = r;
+  tmp_marker.color.g = g;
+  tmp_marker.color.b = b;
+
+  if (tesselateConvexHull<ColorPoint> (hull_cloud, tmp_marker))
+  {
+    vis_pub.publish (tmp_marker);
+  }
+}
 
-  std::stringstream ss;
-  geometry_msgs::Point center;
+void
+hole_hull_cb (const transparent_object_reconstruction::Holes::ConstPtr &holes)
+{
+  ROS_DEBUG ("Retrieved a total of %lu convex hulls", holes->convex_hulls.size ());
 
-  float r,g,b;
-  float h = 0.0f;
-  float color_increment = 360.f
-    / static_cast<float>(holes->convex_hulls.size ());
+  clear_hole_markers ();
 
   for (size_t i = 0; i < holes->convex_hulls.size (); ++i)
   {
     // convert sensor_msgs::PointCloud2 to pcl::PointCloud
     CloudPtr hull_cloud (new Cloud);
     pcl::fromROSMsg (holes->convex_hulls[i], *hull_cloud);
+    publish_hole_marker (hull_cloud, holes->convex_hulls[i].header, i, holes->convex_hulls.size ());
+  }
+}
 
-    // set up header etc. for marker
-    visualization_msgs::Marker tmp_marker (marker);
-    tmp_marker.id = i;
-    tmp_marker.header = holes->convex_hulls[i].header;
-    // assign marker with rainbow color, dependent on number of markers in holes msg
-    hsv2rgb (h, r, g, b);
-    tmp_marker.color.r = r;
-    tmp_marker.color.g = g;
-    tmp_marker.color.b = b;
-    h += color_increment;
-
-    if (tesselateConvexHull<ColorPoint> (hull_cloud, tmp_marker))
-    {
-      vis_pub.publish (tmp_marker);
-    }
+void
+compact_hole_hull_cb (const transparent_object_reconstruction::CompactHoles::ConstPtr &holes)
+{
+  size_t nr_holes = getNrCompactHoles (*holes);
+  ROS_DEBUG ("Retrieved a total of %lu convex hulls", nr_holes);
+
+  clear_hole_markers ();
+
+  for (size_t i = 0; i < nr_holes; ++i)
+  {
+    CloudPtr hull_cloud (new Cloud);
+    getHullFromCompactHoles (*holes, i, *hull_cloud);
+    publish_hole_marker (hull_cloud, holes->header, i, nr_holes);
   }
 }
 
@@ -95,6 +120,7 @@ main (int argc, char **argv)
   marker.color.b = 0.0;
 
   ros::Subscriber sub = n_handle.subscribe ("table_holes", 1, hole_hull_cb);
+  ros::Subscriber compact_sub = n_handle.subscribe ("table_holes_compact", 1, compact_hole_hull_cb);
 
   ros::spin (); 
 
@@ -0,0 +1,147 @@
+#include <ros/serialization.h>
+
+#include <pcl/console/parse.h>
+#include <pcl/common/time.h>
+
+#include <pcl_conversions/pcl_conversions.h>
+
+#include <iostream>
+#include <cstdlib>
+
+#include <transparent_object_reconstruction/common_typedefs.h>
+#include <transparent_object_reconstruction/Holes.h>
+#include <transparent_object_reconstruction/CompactHoles.h>
+#include <transparent_object_reconstruction/tools.h>
+
+void
+usage (int arg, char **argv)
+{
+  std::cout << "usage:\nrosrun transparent_object_reconstruction HolesSerializationBenchmark"
+    << " [-n nr_holes] [-p points_per_hull] [-r repetitions]" << std::endl;
+}
+
+/* Serializes the message into the buffer and deserializes it into 'msg_out', returns the
+ * number of bytes of the serialized message.
+ */
+template <typename MsgT> size_t
+roundTrip (const MsgT &msg, std::vector<uint8_t> &buffer, MsgT &msg_out)
+{
+  uint32_t length = ros::serialization::serializationLength (msg);
+  buffer.resize (length);
+  ros::serialization::OStream out_stream (buffer.data (), length);
+  ros::serialization::serialize (out_stream, msg);
+  ros::serialization::IStream in_stream (buffer.data (), length);
+  ros::serialization::deserialize (in_stream, msg_out);
+  return length;
+}
+
+int
+main (int argc, char **argv)
+{
+  if (pcl::console::find_argument (argc, argv, "-h") > 0)
+  {
+    usage (argc, argv);
+    return EXIT_SUCCESS;
+  }
+
+  int nr_holes = 20;
+  int nr_points = 16;
+  int repetitions = 1000;
+  pcl::console::parse_argument (argc, argv, "-n", nr_holes);
+  pcl::console::parse_argument (argc, argv, "-p", nr_points);
+  pcl::console::parse_argument (argc, argv, "-r", repetitions);
+
+  if (nr_holes < 1 || nr_points < 3 || repetitions < 1)
+  {
+    std::cerr << "invalid arguments, at least one hole with three points is needed" << std::endl;
+    usage (argc, argv);
+    return EXIT_FAILURE;
+  }
+
+  // create random hulls in the plane z = 1
+  srand (42);
+  std::vector<CloudPtr> hulls (nr_holes);
+  for (int i = 0; i < nr_holes; ++i)
+  {
+    hulls[i] = boost::make_shared<Cloud> ();
+    hulls[i]->header.frame_id = "camera_depth_optical_frame";
+    for (int j = 0; j < nr_points; ++j)
+    {
+      ColorPoint p;
+      p.x = static_cast<float> (rand ()) / RAND_MAX;
+      p.y = static_cast<float> (rand ()) / RAND_MAX;
+      p.z = 1.0f;
+      hulls[i]->points.push_back (p);
+    }
+    hulls[i]->width = nr_points;
+    hulls[i]->height = 1;
+  }
+
+  // reference: one PointCloud2 per hull
+  std::vector<uint8_t> buffer;
+  transparent_object_reconstruction::Holes holes_in;
+  size_t holes_bytes = 0;
+  double start = pcl::getTime ();
+  for (int r = 0; r < repetitions; ++r)
+  {
+    transparent_object_reconstruction::Holes holes;
+    holes.convex_hulls.resize (nr_holes);
+    for (int i = 0; i < nr_holes; ++i)
+    {
+      pcl::toROSMsg (*hulls[i], holes.convex_hulls[i]);
+    }
+    holes_bytes = roundTrip (holes, buffer, holes_in);
+    for (int i = 0; i < nr_holes; ++i)
+    {
+      Cloud hull_cloud;
+      pcl::fromROSMsg (holes_in.convex_hulls[i], hull_cloud);
+    }
+  }
+  double holes_duration = pcl::getTime () - start;
+
+  // packed vertices of all hulls
+  transparent_object_reconstruction::CompactHoles compact_in;
+  size_t compact_bytes = 0;
+  start = pcl::getTime ();
+  for (int r = 0; r < repetitions; ++r)
+  {
+    transparent_object_reconstruction::CompactHoles compact_holes;
+    compact_holes.header.frame_id = hulls.front ()->header.frame_id;
+    for (int i = 0; i < nr_holes; ++i)
+    {
+      addHullToCompactHoles (*hulls[i], compact_holes);
+    }
+    compact_bytes = roundTrip (compact_holes, buffer, compact_in);
+    for (int i = 0; i < nr_holes; ++i)
+    {
+      Cloud hull_cloud;
+      getHullFromCompactHoles (compact_in, i, hull_cloud);
+    }
+  }
+  double compact_duration = pcl::getTime () - start;
+
+  // verify that both messages yield identical coordinates
+  size_t nr_mismatches = getNrCompactHoles (compact_in) == static_cast<size_t> (nr_holes) ? 0 : 1;
+  for (int i = 0; nr_mismatches == 0 && i < nr_holes; ++i)
+  {
+    Cloud holes_hull, compact_hull;
+    pcl::fromROSMsg (holes_in.convex_hulls[i], holes_hull);
+    getHullFromCompactHoles (compact_in, i, compact_hull);
+    nr_mismatches += holes_hull.points.size () == compact_hull.points.size () ? 0 : 1;
+    for (size_t j = 0; nr_mismatches == 0 && j < holes_hull.points.size (); ++j)
+    {
+      nr_mismatches += holes_hull.points[j].getVector3fMap () == compact_hull.points[j].getVector3fMap () ? 0 : 1;
+    }
+  }
+
+  std::cout << "holes: " << nr_holes << ", points per hull: " << nr_points
+    << ", repetitions: " << repetitions << std::endl;
+  std::cout << "Holes (encode + round trip + decode):        " << holes_duration * 1000.0 / repetitions
+    << " ms (" << holes_bytes << " bytes)" << std::endl;
+  std::cout << "CompactHoles (encode + round trip + decode): " << compact_duration * 1000.0 / repetitions
+    << " ms (" << compact_bytes << " bytes)" << std::endl;
+  std::cout << "speedup: " << holes_duration / compact_duration << std::endl;
+  std::cout << "mismatching hulls: " << nr_mismatches << std::endl;
+
+  return nr_mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
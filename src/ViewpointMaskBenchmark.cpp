@@ -0,0 +1,123 @@
+#include <pcl/console/parse.h>
+#include <pcl/common/time.h>
+
+#include <boost/icl/interval_set.hpp>
+
+#include <iostream>
+#include <cstdlib>
+
+#include <transparent_object_reconstruction/common_typedefs.h>
+#include <transparent_object_reconstruction/tools.h>
+
+void
+usage (int arg, char **argv)
+{
+  std::cout << "usage:\nrosrun transparent_object_reconstruction ViewpointMaskBenchmark"
+    << " [-n nr_voxels] [-l max_labels_per_voxel] [-r angle_resolution] [-o opening_angle]"
+    << std::endl;
+}
+
+int
+main (int argc, char **argv)
+{
+  if (pcl::console::find_argument (argc, argv, "-h") > 0)
+  {
+    usage (argc, argv);
+    return EXIT_SUCCESS;
+  }
+
+  int nr_voxels = 100000;
+  int max_labels = 40;
+  int angle_resolution = ANGLE_RESOLUTION;
+  int opening_angle = OPENING_ANGLE;
+  pcl::console::parse_argument (argc, argv, "-n", nr_voxels);
+  pcl::console::parse_argument (argc, argv, "-l", max_labels);
+  pcl::console::parse_argument (argc, argv, "-r", angle_resolution);
+  pcl::console::parse_argument (argc, argv, "-o", opening_angle);
+
+  if (nr_voxels < 1 || max_labels < 1 || angle_resolution < 1 ||
+      opening_angle < 0 || opening_angle >= angle_resolution)
+  {
+    std::cerr << "invalid arguments, the opening angle needs to be smaller than the angle resolution"
+      << std::endl;
+    usage (argc, argv);
+    return EXIT_FAILURE;
+  }
+
+  // create random label sets (views of a voxel are typically clustered in a few ranges)
+  srand (42);
+  std::vector<ViewpointMask> label_masks (nr_voxels);
+  std::vector<std::vector<uint32_t> > label_vectors (nr_voxels);
+  for (int i = 0; i < nr_voxels; ++i)
+  {
+    initViewpointMask (label_masks[i], angle_resolution);
+    int nr_labels = 1 + rand () % max_labels;
+    uint32_t label = rand () % angle_resolution;
+    for (int j = 0; j < nr_labels; ++j)
+    {
+      label += rand () % 8;
+      setViewpointMaskLabel (label_masks[i], label, angle_resolution);
+    }
+    convertViewpointMask2LabelVector (label_masks[i], label_vectors[i]);
+  }
+
+  // reference: boost::icl based interval computation
+  std::vector<boost::icl::interval_set<int> > icl_intervals (nr_voxels);
+  size_t icl_marks = 0;
+  double start = pcl::getTime ();
+  for (int i = 0; i < nr_voxels; ++i)
+  {
+    computeViewpointIntervalsICL (label_vectors[i], angle_resolution, opening_angle, icl_intervals[i]);
+    icl_marks += icl_intervals[i].size ();
+  }
+  double icl_duration = pcl::getTime () - start;
+
+  // bitmask based dilation (the intervals are only needed for voxels that are published)
+  std::vector<ViewpointMask> vp_masks (nr_voxels);
+  size_t mask_marks = 0;
+  start = pcl::getTime ();
+  for (int i = 0; i < nr_voxels; ++i)
+  {
+    dilateViewpointMask (label_masks[i], angle_resolution, opening_angle, vp_masks[i]);
+    mask_marks += countViewpointMaskLabels (vp_masks[i]);
+  }
+  double mask_duration = pcl::getTime () - start;
+
+  std::vector<transparent_object_reconstruction::VoxelViewPointIntervals> mask_intervals (nr_voxels);
+  start = pcl::getTime ();
+  for (int i = 0; i < nr_voxels; ++i)
+  {
+    convertViewpointMask2VoxelViewpointIntervals (vp_masks[i], angle_resolution, mask_intervals[i]);
+  }
+  double extraction_duration = pcl::getTime () - start;
+
+  // verify that both implementations yield identical intervals
+  size_t nr_mismatches = 0;
+  transparent_object_reconstruction::VoxelViewPointIntervals icl_msg;
+  for (int i = 0; i < nr_voxels; ++i)
+  {
+    convertICLIntervalSet2VoxelViewpointIntervals (icl_intervals[i], icl_msg);
+    bool identical = icl_msg.intervals.size () == mask_intervals[i].intervals.size ();
+    for (size_t j = 0; identical && j < icl_msg.intervals.size (); ++j)
+    {
+      identical = icl_msg.intervals[j].lower == mask_intervals[i].intervals[j].lower &&
+        icl_msg.intervals[j].upper == mask_intervals[i].intervals[j].upper;
+    }
+    if (!identical)
+    {
+      nr_mismatches++;
+    }
+  }
+
+  std::cout << "voxels: " << nr_voxels << ", angle resolution: " << angle_resolution
+    << ", opening angle: " << opening_angle << std::endl;
+  std::cout << "boost::icl intervals:  " << icl_duration * 1000.0 << " ms ("
+    << icl_marks << " marks)" << std::endl;
+  std::cout << "mask dilation + count: " << mask_duration * 1000.0 << " ms ("
+    << mask_marks << " marks)" << std::endl;
+  std::cout << "interval extraction:   " << extraction_duration * 1000.0 << " ms" << std::endl;
+  std::cout << "speedup (dilation + count): " << icl_duration / mask_duration << std::endl;
+  std::cout << "mismatching voxels: " << nr_mismatches << std::endl;
+
+  return nr_mismatches == 0 && icl_marks == mask_marks ? EXIT_SUCCESS : EXIT_FAILURE;
+}
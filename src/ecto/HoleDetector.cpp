@@ -2,9 +2,15 @@
 #include <ecto_pcl/pcl_cell.hpp>
 
 #include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/image_encodings.h>
 
 #include <ros/console.h>
 
+#include <tf/transform_listener.h>
+#include <tf/transform_datatypes.h>
+
 #include <pcl_conversions/pcl_conversions.h>
 #include <pcl_ros/point_cloud.h>
 
@@ -13,24 +19,28 @@
 
 #include <pcl/sample_consensus/sac_model_plane.h>
 
-#include <pcl/surface/convex_hull.h>
-
 #include <pcl/common/common.h>
 #include <pcl/common/angles.h>
 #include <pcl/common/transforms.h>
 
 #include <pcl/filters/extract_indices.h>
 
+#include <boost/function.hpp>
+
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <Eigen/Dense>
 
 #include <limits>
+#include <stdexcept>
+#include <thread>
 #include <vector>
-#include <queue>
 #include <set>
+#include <map>
+#include <string>
 
 #include<transparent_object_reconstruction/Holes.h>
+#include<transparent_object_reconstruction/CompactHoles.h>
 #include<transparent_object_reconstruction/tools.h>
 
 
@@ -43,6 +53,93 @@ struct Vector2iComp {
     }
 };
 
+/* Per-pixel buffers for the labeling of NaN regions. They are owned by the cell
+ * and reused for consecutive frames; they are reset sparsely after each use.
+ */
+struct NaNLabelingBuffers
+{
+  ImageBuffer<char> seeded;
+  ImageBuffer<int> first_seed;
+  ImageBuffer<int> region_index;
+  UnionFind components;
+  // coarse level of the pyramid mode; the pyramid mask is all finite outside of the labeling
+  ImageBuffer<int> block_counts;
+  ImageBuffer<char> block_seeded;
+  ImageBuffer<char> active_blocks;
+  ImageBuffer<char> pyramid_mask;
+  UnionFind block_components;
+  std::vector<int> component_counts;
+  std::vector<char> component_seeded;
+};
+
+/* Classification of a NaN region w.r.t. the convex hull of the table. */
+enum RegionClass
+{
+  REGION_TOO_SMALL,
+  REGION_OUTSIDE,
+  REGION_OVERLAP,
+  REGION_INSIDE
+};
+
+/* The NaN regions of a frame in flat storage: the hole coordinates of region r are
+ * hole_coords[hole_offsets[r]], ..., hole_coords[hole_offsets[r + 1] - 1] (likewise
+ * for the borders). The storage is owned by the cell and reused for each frame;
+ * regions are referred to by their index only.
+ */
+struct NaNRegions
+{
+  size_t size () const { return classes.size (); };
+  size_t nrHolePixels (size_t r) const { return hole_offsets[r + 1] - hole_offsets[r]; };
+  size_t nrBorderPixels (size_t r) const { return border_offsets[r + 1] - border_offsets[r]; };
+  const Eigen::Vector2i* holeBegin (size_t r) const { return hole_coords.data () + hole_offsets[r]; };
+  const Eigen::Vector2i* holeEnd (size_t r) const { return hole_coords.data () + hole_offsets[r + 1]; };
+  const Eigen::Vector2i* borderBegin (size_t r) const { return border_coords.data () + border_offsets[r]; };
+  const Eigen::Vector2i* borderEnd (size_t r) const { return border_coords.data () + border_offsets[r + 1]; };
+
+  std::vector<Eigen::Vector2i> hole_coords;
+  std::vector<Eigen::Vector2i> border_coords;
+  std::vector<size_t> hole_offsets;
+  std::vector<size_t> border_offsets;
+  std::vector<size_t> inside_counts;  // number of hole pixels inside the table hull
+  std::vector<RegionClass> classes;
+};
+
+/* The state of a frame between the labeling of its NaN regions and the computation of
+ * its hulls. In the pipelined mode of HoleDetector the next frame is labeled into a
+ * second instance, which is swapped with the state of the cell afterwards.
+ */
+struct FrameState
+{
+  ecto::pcl::xyz_cloud_variant_t input;
+  ::pcl::ModelCoefficients::ConstPtr model;
+  std::vector<Eigen::Vector2i> table_hull_coords;
+  ImageBuffer<char> finite_mask;
+  ImageBuffer<char> table_mask;
+  std::vector<Eigen::Vector3i> table_spans;
+  NaNRegions regions;
+};
+
+/* Edge length of the tiles in which the NaN mask is compared between frames in the
+ * temporal mode, and the margin around a region that needs to be unchanged as well
+ * (the erosion of the border reads the finite mask in this neighborhood).
+ */
+static const int TEMPORAL_TILE_SIZE = 32;
+static const int TEMPORAL_TILE_MARGIN = 3;
+
+/* The hull computed for a NaN region, kept across frames in the temporal mode. Entries
+ * are keyed by the first hole pixel of their region; 'has_hull' is false for regions
+ * that were discarded. The hull cloud is stored independently of the point type.
+ */
+struct CachedRegionHull
+{
+  size_t nr_hole_pixels;
+  size_t nr_border_pixels;
+  RegionClass region_class;
+  bool has_hull;
+  ::pcl::PCLPointCloud2 hull_cloud;
+  std::vector<Eigen::Vector2i> hull_coords;
+};
+
 struct HoleDetector
 {
   static void calcPlaneTransformation (Eigen::Vector3f plane_normal,
@@ -88,75 +185,136 @@ struct HoleDetector
         plane_normal, origin, transformation);
   }
 
-  template <typename PointT>
-    bool validPoint (boost::shared_ptr<const ::pcl::PointCloud<PointT> > &cloud,
-        const Eigen::Vector2i &coords)
-    {
-      if (coords[0] >= 0 && coords[1] >= 0 && coords[0] < cloud->width && coords[1] < cloud->height)
-      {
-        if (::pcl::isFinite<PointT> (cloud->at (coords[0], coords[1])))
-          return true;
-      }
-      return false;
-    }
-
   /**
     * @brief: Erodes a given border.
-    * The 2D border coordinates are smeared into x-y direction by the specified erode size.
-    * In the returned boorder coordinates, each coordinate is included only once.
+    * The 2D border coordinates are smeared into x-y direction by the specified erode size,
+    * i.e., the border is dilated with a cross-shaped structuring element; only finite points
+    * are added. The dilation is done on a bitmap restricted to the bbox of the eroded border
+    * by separate passes along the rows and columns. The returned border coordinates are
+    * unique and in row-major order.
     *
     * @param[in] input_cloud The complete point cloud
-    * @param[in,out] border_coords The 2D coordinates of the border of the hole
-    * @param[out] border_cloud The 3D points corresponding to the border of the hole
+    * @param[in] finite_mask The finite mask of the complete point cloud
+    * @param[in] border_begin Pointer to the first 2D coordinate of the border of the hole
+    * @param[in] border_end Pointer past the last 2D coordinate of the border of the hole
+    * @param[out] eroded_coords The 2D coordinates of the eroded border
+    * @param[out] border_cloud The 3D points corresponding to the eroded border of the hole
     * @param[in] erode_size The number of coordinates to extend the border
     */
   template <typename PointT>
   void erodeBorder (boost::shared_ptr<const ::pcl::PointCloud<PointT> > &input_cloud,
-      std::vector<Eigen::Vector2i> &border_coords,
+      const ImageBuffer<char> &finite_mask,
+      const Eigen::Vector2i *border_begin, const Eigen::Vector2i *border_end,
+      std::vector<Eigen::Vector2i> &eroded_coords,
       boost::shared_ptr<::pcl::PointCloud<PointT> > &border_cloud,
       size_t erode_size)
   {
+    // pixel flags inside the dilation bitmap
+    static const char BORDER = 1;
+    static const char DILATED = 2;
+
     // clear / prepare outputs
     border_cloud->points.clear ();
-    std::vector<Eigen::Vector2i> tmp_coords;
-
-    Eigen::Vector2i tmp;
-    Eigen::Vector2i x_shift (1, 0);
-    Eigen::Vector2i y_shift = Eigen::Vector2i (0, 1);
-    std::pair<std::set<Eigen::Vector2i, Vector2iComp>::iterator, bool> insert_res;
-    std::set<Eigen::Vector2i, Vector2iComp> extended_border_coord_set;
-    std::set<Eigen::Vector2i, Vector2iComp>::const_iterator set_it;
-    std::vector<Eigen::Vector2i>::const_iterator c_it = border_coords.begin ();
-
-    // do the erosion, but only add  coords that are valid and only add them once
-    while (c_it != border_coords.end ())
-    {
-      extended_border_coord_set.insert (*c_it);
-      for (size_t i = 1; i <= erode_size; ++i)
-      {
-        if (validPoint (input_cloud, (*c_it) + (i * x_shift)))
-          extended_border_coord_set.insert ((*c_it) + (i * x_shift));
-        if (validPoint (input_cloud, (*c_it) - (i * x_shift)))
-          extended_border_coord_set.insert ((*c_it) - (i * x_shift));
-        if (validPoint (input_cloud, (*c_it) + (i * y_shift)))
-          extended_border_coord_set.insert ((*c_it) + (i * y_shift));
-        if (validPoint (input_cloud, (*c_it) - (i * y_shift)))
-          extended_border_coord_set.insert ((*c_it) - (i * y_shift));
-      }
+    border_cloud->header = input_cloud->header;
+    border_cloud->width = 0;
+    border_cloud->height = 1;
+    eroded_coords.clear ();
+    if (border_begin == border_end)
+      return;
+
+    // the bitmap is only reallocated if the image dimensions change; it is all zero
+    // outside of calls to this method
+    dilation_mask_.resize (finite_mask.width (), finite_mask.height (), 0);
+    const int width = finite_mask.width ();
+    const int erode = static_cast<int> (erode_size);
+
+    // mark the border and determine the bbox of the eroded border
+    Eigen::Vector2i min = *border_begin;
+    Eigen::Vector2i max = *border_begin;
+    const Eigen::Vector2i *c_it = border_begin;
+    while (c_it != border_end)
+    {
+      dilation_mask_ ((*c_it)[0], (*c_it)[1]) = BORDER;
+      min = min.cwiseMin (*c_it);
+      max = max.cwiseMax (*c_it);
       c_it++;
     }
-    border_cloud->points.reserve (extended_border_coord_set.size ());
-    tmp_coords.reserve (extended_border_coord_set.size ());
-    set_it = extended_border_coord_set.begin ();
-    while (set_it != extended_border_coord_set.end ())
+    min = (min - Eigen::Vector2i (erode, erode)).cwiseMax (Eigen::Vector2i (0, 0));
+    max = (max + Eigen::Vector2i (erode, erode)).cwiseMin (
+        Eigen::Vector2i (width - 1, finite_mask.height () - 1));
+
+    // horizontal pass: mark all pixels within 'erode_size' of a border pixel in the same row
+    for (int v = min[1]; v <= max[1]; ++v)
+    {
+      char *row = &dilation_mask_ (0, v);
+      for (int u = min[0], last = -erode - 1; u <= max[0]; ++u)
+      {
+        if (row[u] & BORDER)
+          last = u;
+        if (u - last <= erode)
+          row[u] |= DILATED;
+      }
+      for (int u = max[0], last = max[0] + erode + 1; u >= min[0]; --u)
+      {
+        if (row[u] & BORDER)
+          last = u;
+        if (last - u <= erode)
+          row[u] |= DILATED;
+      }
+    }
+    // vertical pass: same for the columns (processed row by row for cache efficiency)
+    std::vector<int> last_above (max[0] - min[0] + 1, min[1] - erode - 1);
+    for (int v = min[1]; v <= max[1]; ++v)
+    {
+      char *row = &dilation_mask_ (0, v);
+      for (int u = min[0]; u <= max[0]; ++u)
+      {
+        if (row[u] & BORDER)
+          last_above[u - min[0]] = v;
+        if (v - last_above[u - min[0]] <= erode)
+          row[u] |= DILATED;
+      }
+    }
+    std::vector<int> last_below (max[0] - min[0] + 1, max[1] + erode + 1);
+    for (int v = max[1]; v >= min[1]; --v)
     {
-      border_cloud->points.push_back (input_cloud->at ((*set_it)[0], (*set_it)[1]));
-      tmp_coords.push_back (*set_it++);
+      char *row = &dilation_mask_ (0, v);
+      for (int u = min[0]; u <= max[0]; ++u)
+      {
+        if (row[u] & BORDER)
+          last_below[u - min[0]] = v;
+        if (last_below[u - min[0]] - v <= erode)
+          row[u] |= DILATED;
+      }
+    }
+
+    // collect the border and all finite dilated pixels in row-major order, reset the bitmap
+    eroded_coords.reserve ((border_end - border_begin) * (1 + 2 * erode_size));
+    border_cloud->points.reserve (eroded_coords.capacity ());
+    for (int v = min[1]; v <= max[1]; ++v)
+    {
+      char *row = &dilation_mask_ (0, v);
+      const char *finite_row = &finite_mask (0, v);
+      for (int u = min[0]; u <= max[0]; ++u)
+      {
+        if ((row[u] & BORDER) || ((row[u] & DILATED) && finite_row[u]))
+        {
+          eroded_coords.push_back (Eigen::Vector2i (u, v));
+        }
+        row[u] = 0;
+      }
+    }
+    if (prepare_points_)
+    {
+      prepare_points_ (eroded_coords.data (), eroded_coords.data () + eroded_coords.size ());
+    }
+    std::vector<Eigen::Vector2i>::const_iterator coord_it = eroded_coords.begin ();
+    while (coord_it != eroded_coords.end ())
+    {
+      border_cloud->points.push_back (input_cloud->points[(*coord_it)[1] * width + (*coord_it)[0]]);
+      coord_it++;
     }
-    border_cloud->header = input_cloud->header;
     border_cloud->width = border_cloud->points.size ();
-    border_cloud->height = 1;
-    border_coords.swap (tmp_coords);  // put the new coordinates into output argument
   }
 
   template <typename PointT>
@@ -165,17 +323,48 @@ struct HoleDetector
     {
       auto proj_border_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
 
-      Eigen::Vector4f plane = Eigen::Vector4f ((*model_)->values[0],
-          (*model_)->values[1], (*model_)->values[2], (*model_)->values[3]);
+      Eigen::Vector4f plane = Eigen::Vector4f (model_coefficients_->values[0],
+          model_coefficients_->values[1], model_coefficients_->values[2], model_coefficients_->values[3]);
 
       projectPointCloudOnPlane<PointT> (border_cloud, plane, proj_border_cloud);
 
       // compute the convex hull of the (projected) border and retrieve the point indices
-      typename ::pcl::ConvexHull<PointT> c_hull;
-      c_hull.setInputCloud (proj_border_cloud);
-      c_hull.setDimension (2);
-      c_hull.reconstruct (*convex_hull);
-      c_hull.getHullPointIndices (convex_hull_indices);
+      createPlaneConvexHull (proj_border_cloud, convex_hull, convex_hull_indices);
+    }
+
+  /* Computes the convex hull of a point cloud that lies in the table plane. The points
+   * are expressed in 2D coordinates of the plane and their hull is computed via
+   * 'convexHull2D ()'; the hull points are returned in counter-clockwise order.
+   */
+  template <typename PointT>
+    void createPlaneConvexHull (const boost::shared_ptr<::pcl::PointCloud<PointT> > &plane_cloud,
+        boost::shared_ptr<::pcl::PointCloud<PointT> > &convex_hull, ::pcl::PointIndices &convex_hull_indices)
+    {
+      Eigen::Vector3f plane_normal = Eigen::Vector3f (model_coefficients_->values[0],
+          model_coefficients_->values[1], model_coefficients_->values[2]).normalized ();
+      Eigen::Vector3f axis_u = plane_normal.unitOrthogonal ();
+      Eigen::Vector3f axis_v = plane_normal.cross (axis_u);
+
+      hull_plane_coords_.resize (plane_cloud->points.size ());
+      for (size_t i = 0; i < plane_cloud->points.size (); ++i)
+      {
+        Eigen::Vector3f p = plane_cloud->points[i].getVector3fMap ();
+        hull_plane_coords_[i] = Eigen::Vector2f (p.dot (axis_u), p.dot (axis_v));
+      }
+      convexHull2D (hull_plane_coords_, convex_hull_indices.indices, hull_sort_buffer_);
+
+      convex_hull->points.clear ();
+      convex_hull->points.reserve (convex_hull_indices.indices.size ());
+      std::vector<int>::const_iterator index_it = convex_hull_indices.indices.begin ();
+      while (index_it != convex_hull_indices.indices.end ())
+      {
+        convex_hull->points.push_back (plane_cloud->points[*index_it++]);
+      }
+      convex_hull->header = plane_cloud->header;
+      convex_hull->width = convex_hull->points.size ();
+      convex_hull->height = 1;
+      convex_hull->is_dense = true;
+      convex_hull_indices.header = plane_cloud->header;
     }
 
   // TODO: more sophisticated test could check if the hull only touches the border (with on point)
@@ -273,312 +462,568 @@ struct HoleDetector
     }
 
 
+  /* Marks the finite pixels inside the given convex hull in the removal mask of the cell
+   * and extends the bbox of all marked pixels accordingly.
+   */
   template <typename PointT>
-    void addRemoveIndices (boost::shared_ptr<const ::pcl::PointCloud<PointT> > &cloud,
-        const std::vector<Eigen::Vector2i> &convex_hull,
-        ::pcl::PointIndices::Ptr &remove_indices, bool &touches_border)
+    void markRemovePixels (boost::shared_ptr<const ::pcl::PointCloud<PointT> > &cloud,
+        const ImageBuffer<char> &finite_mask,
+        const std::vector<Eigen::Vector2i> &convex_hull, bool &touches_border)
     {
       // retrieve 2D bbox of convex hull
       Eigen::Vector2i min, max;
       get2DHullBBox (cloud, convex_hull, min, max, touches_border);
 
-      // reserve the upper limit of newly needed entries into remove_indices
-      remove_indices->indices.reserve (remove_indices->indices.size () + (max[0] - min[0]) * (max[1] - min[1]));
-      Eigen::Vector2i query_point;
-      int point_index;
-
-      for (int u = min[0]; u < max[0]; ++u)
+      // visit the points inside the convex hull row by row
+      std::vector<Eigen::Vector3i> spans;
+      polygonScanlineSpans2D (convex_hull, spans);
+      std::vector<Eigen::Vector3i>::const_iterator span_it = spans.begin ();
+      while (span_it != spans.end ())
       {
-        query_point[0] = u;
-        for (int v = min[1]; v < max[1]; ++v)
+        int v = (*span_it)[0];
+        int u_begin = std::max ((*span_it)[1], min[0]);
+        int u_end = std::min ((*span_it)[2] + 1, max[0]);
+        if (v >= min[1] && v < max[1] && u_begin < u_end)
         {
-          query_point[1] = v;
-          // check if point is inside the convex hull
-          if (pointInPolygon2D (convex_hull, query_point))
+          char *remove_row = &remove_mask_ (0, v);
+          const char *finite_row = &finite_mask (0, v);
+          for (int u = u_begin; u < u_end; ++u)
           {
-            if (::pcl::isFinite (cloud->at (u, v)))
-            {
-              convert2DCoordsToIndex (cloud, u, v, point_index);
-              remove_indices->indices.push_back (point_index);
-            }
+            remove_row[u] |= finite_row[u];
           }
+          remove_min_ = remove_min_.cwiseMin (Eigen::Vector2i (u_begin, v));
+          remove_max_ = remove_max_.cwiseMax (Eigen::Vector2i (u_end - 1, v));
         }
+        span_it++;
       }
     }
 
-  static bool pointInPolygon2D (const std::vector<Eigen::Vector2i> &polygon,
-      const Eigen::Vector2i &query_point)
+  /* Rasterizes the convex hull of the table (clipped to the image) into the cell-owned
+   * table mask, such that inside tests are plain lookups. The spans of the previous frame
+   * (stored in 'table_spans') are reset beforehand, unless the mask had to be reallocated.
+   */
+  static void rasterizeTableHull (const std::vector<Eigen::Vector2i> &hull_2Dcoords, int width, int height,
+      ImageBuffer<char> &table_mask, std::vector<Eigen::Vector3i> &table_spans)
   {
-    bool inside = false;
+    if (!table_mask.resize (width, height, 0))
+    {
+      std::vector<Eigen::Vector3i>::const_iterator span_it = table_spans.begin ();
+      while (span_it != table_spans.end ())
+      {
+        table_mask.fill (0, Eigen::Vector2i ((*span_it)[1], (*span_it)[0]),
+            Eigen::Vector2i ((*span_it)[2], (*span_it)[0]));
+        span_it++;
+      }
+    }
 
-    std::vector<Eigen::Vector2i>::const_iterator start_it, end_it;
-    start_it = polygon.end () - 1;  // last vertex
-    end_it = polygon.begin ();
-    bool start_above, end_above;
+    std::vector<Eigen::Vector3i> spans;
+    polygonScanlineSpans2D (hull_2Dcoords, spans);
+    table_spans.clear ();
+    table_spans.reserve (spans.size ());
+    std::vector<Eigen::Vector3i>::const_iterator span_it = spans.begin ();
+    while (span_it != spans.end ())
+    {
+      Eigen::Vector3i span (*span_it++);
+      span[1] = std::max (span[1], 0);
+      span[2] = std::min (span[2], width - 1);
+      if (span[0] >= 0 && span[0] < height && span[1] <= span[2])
+      {
+        table_mask.fill (1, Eigen::Vector2i (span[1], span[0]), Eigen::Vector2i (span[2], span[0]));
+        table_spans.push_back (span);
+      }
+    }
+  }
 
-    start_above = (*start_it)[1] >= query_point[1] ? true: false;
-    while (end_it != polygon.end ())
+  /* Calls 'function (u, v, i)' for the pixels of all active blocks inside the rectangle
+   * [min, max) in row-major order, where i = v * width + u.
+   */
+  template <typename FunctionT>
+  static void forEachActivePixel (const ImageBuffer<char> &active_blocks, int block_size,
+      const Eigen::Vector2i &min, const Eigen::Vector2i &max, int width, const FunctionT &function)
+  {
+    for (int v = min[1]; v < max[1]; ++v)
     {
-      end_above = (*end_it)[1] >= query_point[1] ? true : false;
+      const char *active_row = &active_blocks (0, v / block_size);
+      for (int block_u = min[0] / block_size; block_u * block_size < max[0]; ++block_u)
+      {
+        if (!active_row[block_u])
+          continue;
+        const int u_end = std::min ((block_u + 1) * block_size, max[0]);
+        for (int u = std::max (block_u * block_size, min[0]), i = v * width + u; u < u_end; ++u, ++i)
+        {
+          function (u, v, i);
+        }
+      }
+    }
+  }
+
+  /* Same as above for the complete image. */
+  template <typename FunctionT>
+  static void forEachActivePixel (const ImageBuffer<char> &active_blocks, int block_size,
+      int width, int height, const FunctionT &function)
+  {
+    forEachActivePixel (active_blocks, block_size, Eigen::Vector2i (0, 0),
+        Eigen::Vector2i (width, height), width, function);
+  }
 
-      if (start_above != end_above)
+  /* Same as 'forEachActivePixel ()', but in column-major order. */
+  template <typename FunctionT>
+  static void forEachActivePixelColumnMajor (const ImageBuffer<char> &active_blocks, int block_size,
+      int width, int height, const FunctionT &function)
+  {
+    for (int u = 0; u < width; ++u)
+    {
+      const int block_u = u / block_size;
+      for (int block_v = 0; block_v < active_blocks.height (); ++block_v)
       {
-        if (((*end_it)[1] - query_point[1]) * ((*end_it)[0] - (*start_it)[0]) <=
-            ((*end_it)[1] - (*start_it)[1]) * ((*end_it)[0] - query_point[0]))
+        if (!active_blocks (block_u, block_v))
+          continue;
+        const int v_end = std::min ((block_v + 1) * block_size, height);
+        for (int v = block_v * block_size, i = v * width + u; v < v_end; ++v, i += width)
         {
-          if (end_above)
-          {
-            inside = !inside;
-          }
+          function (u, v, i);
         }
-        else
+      }
+    }
+  }
+
+  /* Determines the blocks of the pyramid mode that are labeled at full resolution. The
+   * number of NaN pixels (and whether one of them is inside the table hull) is reduced
+   * per block, and the blocks containing NaN pixels are 8-connected into coarse
+   * components. Each NaN region lies inside a single coarse component (for a block size
+   * of at least 2 this holds for regions merged via a border pixel as well), thus only
+   * components with at least 'min_region_size' NaN pixels and a seed can contain regions
+   * that are not too small. The blocks of these components, dilated by one block to
+   * include the region borders, are marked in 'buffers.active_blocks'.
+   *
+   * @returns the number of active blocks
+   */
+  static size_t selectActiveBlocks (
+      const ImageBuffer<char> &finite_mask,
+      const ImageBuffer<char> &table_mask,
+      int block_size,
+      size_t min_region_size,
+      NaNLabelingBuffers &buffers)
+  {
+    const int width = finite_mask.width ();
+    const int height = finite_mask.height ();
+    const int nr_blocks_u = (width + block_size - 1) / block_size;
+    const int nr_blocks_v = (height + block_size - 1) / block_size;
+    const int nr_blocks = nr_blocks_u * nr_blocks_v;
+
+    ImageBuffer<int> &block_counts = buffers.block_counts;
+    ImageBuffer<char> &block_seeded = buffers.block_seeded;
+    ImageBuffer<char> &active_blocks = buffers.active_blocks;
+    UnionFind &block_components = buffers.block_components;
+    block_counts.resize (nr_blocks_u, nr_blocks_v);
+    block_seeded.resize (nr_blocks_u, nr_blocks_v);
+    active_blocks.resize (nr_blocks_u, nr_blocks_v);
+    block_counts.fill (0);
+    block_seeded.fill (0);
+    active_blocks.fill (0);
+    block_components.resize (nr_blocks);
+
+    // reduce the NaN pixels and seeds per block
+    for (int v = 0; v < height; ++v)
+    {
+      const char *finite_row = &finite_mask (0, v);
+      const char *table_row = &table_mask (0, v);
+      int *count_row = &block_counts (0, v / block_size);
+      char *seeded_row = &block_seeded (0, v / block_size);
+      for (int block_u = 0; block_u < nr_blocks_u; ++block_u)
+      {
+        const int u_end = std::min ((block_u + 1) * block_size, width);
+        int count = 0;
+        char seeded = 0;
+        for (int u = block_u * block_size; u < u_end; ++u)
+        {
+          count += !finite_row[u];
+          seeded |= !finite_row[u] & table_row[u];
+        }
+        count_row[block_u] += count;
+        seeded_row[block_u] |= seeded;
+      }
+    }
+
+    // connect the blocks containing NaN pixels with their 8-neighbors
+    for (int block_v = 0; block_v < nr_blocks_v; ++block_v)
+    {
+      for (int block_u = 0, i = block_v * nr_blocks_u; block_u < nr_blocks_u; ++block_u, ++i)
+      {
+        if (block_counts[i] == 0)
+          continue;
+        block_components.makeSet (i);
+        if (block_u > 0 && block_counts[i - 1] > 0)
+          block_components.unite (i, i - 1);
+        if (block_v > 0)
         {
-          if (!end_above)
+          for (int n = std::max (block_u - 1, 0); n <= std::min (block_u + 1, nr_blocks_u - 1); ++n)
           {
-            inside = !inside;
+            if (block_counts[i - nr_blocks_u - block_u + n] > 0)
+              block_components.unite (i, i - nr_blocks_u - block_u + n);
           }
         }
       }
-      start_above = end_above;
-      start_it = end_it;
-      end_it++;
     }
 
-    return inside;
-  }
+    // accumulate the NaN pixels and seeds per coarse component
+    std::vector<int> &component_counts = buffers.component_counts;
+    std::vector<char> &component_seeded = buffers.component_seeded;
+    component_counts.assign (nr_blocks, 0);
+    component_seeded.assign (nr_blocks, 0);
+    for (int i = 0; i < nr_blocks; ++i)
+    {
+      if (block_counts[i] == 0)
+        continue;
+      int component = block_components.find (i);
+      component_counts[component] += block_counts[i];
+      component_seeded[component] |= block_seeded[i];
+    }
 
-  template <typename PointT>
-    static void recursiveNaNGrowing (
-        boost::shared_ptr<const ::pcl::PointCloud<PointT> > &cloud,
-        int column, int row,
-        std::vector<Eigen::Vector2i> &hole_2Dcoords,
-        std::vector<Eigen::Vector2i> &border_2Dcoords,
-        std::vector<std::vector<bool> > &visited)
-    {
-      // check dimension
-      if (column < 0 || row < 0 ||
-          column >= cloud->width || row >= cloud->height)
-        return;
-      // check if already visited and nan-point -- borders may be part of two neighboring regions
-      auto p = cloud->at (column, row);
-      if (visited[column][row] && !pcl_isfinite (p.x))
-        return;
-      visited[column][row] = true;
-      Eigen::Vector2i coordinates (column, row);
-      if (pcl_isfinite (p.x))
+    // mark the blocks of the relevant components and their neighbors
+    size_t nr_active = 0;
+    for (int block_v = 0; block_v < nr_blocks_v; ++block_v)
+    {
+      for (int block_u = 0, i = block_v * nr_blocks_u; block_u < nr_blocks_u; ++block_u, ++i)
       {
-        border_2Dcoords.push_back (coordinates);
-        return;
+        if (block_counts[i] == 0)
+          continue;
+        int component = block_components.find (i);
+        if (!component_seeded[component] ||
+            static_cast<size_t> (component_counts[component]) < min_region_size)
+          continue;
+        Eigen::Vector2i min (std::max (block_u - 1, 0), std::max (block_v - 1, 0));
+        Eigen::Vector2i max (std::min (block_u + 1, nr_blocks_u - 1), std::min (block_v + 1, nr_blocks_v - 1));
+        active_blocks.fill (1, min, max);
       }
-      hole_2Dcoords.push_back (coordinates);
-      recursiveNaNGrowing (cloud, column - 1, row, hole_2Dcoords, border_2Dcoords, visited);
-      recursiveNaNGrowing (cloud, column + 1, row, hole_2Dcoords, border_2Dcoords, visited);
-      recursiveNaNGrowing (cloud, column, row - 1, hole_2Dcoords, border_2Dcoords, visited);
-      recursiveNaNGrowing (cloud, column, row + 1, hole_2Dcoords, border_2Dcoords, visited);
     }
-
-  template <typename PointT>
-    static void iterativeNaNGrowing (
-        boost::shared_ptr<const ::pcl::PointCloud<PointT> > &cloud,
-        const std::vector<Eigen::Vector2i> &hull_2Dcoords,
-        const Eigen::Vector2i &table_min,
-        const Eigen::Vector2i &table_max,
-        std::list<std::vector<Eigen::Vector2i> > &holes_list,
-        std::list<std::set<Eigen::Vector2i, Vector2iComp> > &borders_list)
+    for (int i = 0; i < nr_blocks; ++i)
     {
-      // iterative version of the recursive NaN-growing that can segfault, due to recursion depth...
-      // clear output arguments
-      holes_list.clear ();
-      borders_list.clear ();
-
-      // create the inserted list locally
-      std::vector<std::vector<bool> > inserted (cloud->width, std::vector<bool> (cloud->height, false));
-      std::queue<Eigen::Vector2i> expansion_queue;
+      nr_active += active_blocks[i];
+    }
+    return nr_active;
+  }
 
-      // needed iterators
-      std::list<std::set<Eigen::Vector2i, Vector2iComp> >::iterator border_list_it;
-      std::list<std::vector<Eigen::Vector2i> >::iterator hole_list_it;
+  /* Determines the NaN regions of an organized cloud that contain at least one
+   * NaN pixel inside the convex hull of the table (seeds), together with their
+   * borders, i.e., the finite pixels that are 4-connected to a region. Regions
+   * that share a border pixel are merged. The 4-connected NaN components are
+   * labeled for the whole image with a two-pass union-find labeling, since a
+   * region may extend beyond the bounding box of the table.
+   * Regions are ordered by their first seed pixel (column-major) and hole and
+   * border coordinates of each region are sorted w.r.t. Vector2iComp. For each
+   * region the number of its pixels inside the table hull is counted as well.
+   * All regions are classified as REGION_INSIDE.
+   * Only the pixels of the active blocks (of size 'block_size') are visited; all
+   * pixels outside of them need to be finite in 'finite_mask'.
+   * If 'nr_threads' differs from 1, the components are labeled in tiles of size
+   * 'tile_size' in parallel on 'thread_pool' (0 threads uses one per core); the result
+   * is identical.
+   */
+  static void labelNaNRegions (
+      const ImageBuffer<char> &finite_mask,
+      const ImageBuffer<char> &table_mask,
+      const std::vector<Eigen::Vector3i> &table_spans,
+      const ImageBuffer<char> &active_blocks,
+      int block_size,
+      int tile_size,
+      size_t nr_threads,
+      ThreadPool &thread_pool,
+      NaNLabelingBuffers &buffers,
+      NaNRegions &regions)
+  {
 
-      // iterate over the bounding box of the table and check for seeds of nan regions
-      for (int u = table_min[0]; u <= table_max[0]; ++u)
+    const int width = finite_mask.width ();
+    const int height = finite_mask.height ();
+    const int nr_pixels = width * height;
+
+    // (re)allocate buffers only if the image dimensions changed
+    ImageBuffer<char> &seeded = buffers.seeded;
+    ImageBuffer<int> &first_seed = buffers.first_seed;
+    ImageBuffer<int> &region_index = buffers.region_index;
+    UnionFind &components = buffers.components;
+    seeded.resize (width, height, 0);
+    first_seed.resize (width, height, std::numeric_limits<int>::max ());
+    region_index.resize (width, height, -1);
+    components.resize (nr_pixels);
+
+    // first pass: connect each nan pixel with its left and upper nan neighbor inside of its
+    // tile; the tiles touch disjoint sets of pixels and are thus processed in parallel
+    const int tile = tile_size > 0 && nr_threads != 1 ? tile_size : std::max (width, height);
+    const int nr_tiles_u = (width + tile - 1) / tile;
+    const int nr_tiles_v = (height + tile - 1) / tile;
+    thread_pool.parallelFor (nr_tiles_u * nr_tiles_v, nr_threads, [&] (size_t t)
+    {
+      const Eigen::Vector2i min ((t % nr_tiles_u) * tile, (t / nr_tiles_u) * tile);
+      const Eigen::Vector2i max (std::min (min[0] + tile, width), std::min (min[1] + tile, height));
+      forEachActivePixel (active_blocks, block_size, min, max, width, [&] (int u, int v, int i)
       {
-        for (int v = table_min[1]; v <= table_max[1]; ++v)
+        if (!finite_mask[i])
         {
-          if (!inserted[u][v] &&                                            // already used?
-              !(::pcl::isFinite (cloud->at (u, v))) &&                      // nan point?
-              pointInPolygon2D (hull_2Dcoords, Eigen::Vector2i (u, v)))     // inside hull?
-          {
-            std::vector<Eigen::Vector2i> current_hole;
-            std::set<Eigen::Vector2i, Vector2iComp> current_border;
-
-            // insert into expansion queue and mark as inserted
-            expansion_queue.push (Eigen::Vector2i (u, v));
-            inserted[u][v] = true;
-            while (!expansion_queue.empty ())
-            {
-              // take the first element and remove it from the queue
-              Eigen::Vector2i current_coordinate = expansion_queue.front ();
-              expansion_queue.pop ();
-
-              current_hole.push_back (current_coordinate);
-              // generate potential neighbors;
-              std::vector<Eigen::Vector2i> neighbors (4, current_coordinate);
-              neighbors[0][0] -= 1;
-              neighbors[1][0] += 1;
-              neighbors[2][1] -= 1;
-              neighbors[3][1] += 1;
-
-              for (size_t i = 0; i < neighbors.size (); ++i)
-              {
-                Eigen::Vector2i neighbor = neighbors[i];
-                // TODO: use this place to mark region as touching border?
-                if ((neighbor[0] >= 0) && (neighbor[0] < cloud->width) &&
-                    (neighbor[1] >= 0) && (neighbor[1] < cloud->height))
-                {
-                  if (::pcl::isFinite (cloud->at (neighbor[0], neighbor[1])))
-                  {
-                    // note that a border is not set as inserted
-                    // since it could potentially be border of 2 neighboring regions
-                    current_border.insert (neighbor);
-                  }
-                  else
-                  {
-                    if (!inserted[neighbor[0]][neighbor[1]])
-                    {
-                      // add nan coordinate to the queue and mark as inserted
-                      expansion_queue.push (neighbor);
-                      inserted[neighbor[0]][neighbor[1]] = true;
-                    }
-                  }
-                }
-              }
-            }
-
-            // check if the current region shares a border with an already existing region
-            std::list<std::list<std::set<Eigen::Vector2i, Vector2iComp> >::iterator> shared_border_list;
-            std::list<std::list<std::vector<Eigen::Vector2i> >::iterator> shared_hole_list;
+          components.makeSet (i);
+          if (u > min[0] && !finite_mask[i - 1])
+            components.unite (i, i - 1);
+          if (v > min[1] && !finite_mask[i - width])
+            components.unite (i, i - width);
+        }
+      });
+    });
+    // merge the tiles along their seams; since each set is represented by its smallest
+    // element, the labels do not depend on the tiling
+    for (int tile_u = 1; tile_u < nr_tiles_u; ++tile_u)
+    {
+      for (int v = 0, i = tile_u * tile; v < height; ++v, i += width)
+      {
+        if (!finite_mask[i] && !finite_mask[i - 1])
+          components.unite (i, i - 1);
+      }
+    }
+    for (int tile_v = 1; tile_v < nr_tiles_v; ++tile_v)
+    {
+      for (int u = 0, i = tile_v * tile * width; u < width; ++u, ++i)
+      {
+        if (!finite_mask[i] && !finite_mask[i - width])
+          components.unite (i, i - width);
+      }
+    }
+    // second pass: resolve labels (parents always have smaller indices)
+    forEachActivePixel (active_blocks, block_size, width, height, [&] (int u, int v, int i)
+    {
+      if (!finite_mask[i])
+        components.parent[i] = components.parent[components.parent[i]];
+    });
+
+    // find the components with seeds inside the convex hull; for each seeded component
+    // remember its first seed in column-major order
+    std::vector<int> seeded_components;
+    std::vector<Eigen::Vector3i>::const_iterator span_it = table_spans.begin ();
+    while (span_it != table_spans.end ())
+    {
+      int v = (*span_it)[0];
+      for (int u = (*span_it)[1]; u <= (*span_it)[2]; ++u)
+      {
+        int i = v * width + u;
+        if (!finite_mask[i])
+        {
+          int component = components.parent[i];
+          if (first_seed[component] == std::numeric_limits<int>::max ())
+            seeded_components.push_back (component);
+          first_seed[component] = std::min (first_seed[component], u * height + v);
+        }
+      }
+      span_it++;
+    }
 
-            border_list_it = borders_list.begin ();
-            hole_list_it = holes_list.begin ();
+    // merge seeded components that share a border pixel
+    std::vector<int>::const_iterator comp_it = seeded_components.begin ();
+    while (comp_it != seeded_components.end ())
+    {
+      seeded[*comp_it++] = 1;
+    }
+    int neighbors[4];
+    forEachActivePixel (active_blocks, block_size, width, height, [&] (int u, int v, int i)
+    {
+      if (!finite_mask[i])
+        return;
+      int nr_neighbors = 0;
+      if (u > 0 && !finite_mask[i - 1] && seeded[components.parent[i - 1]])
+        neighbors[nr_neighbors++] = components.parent[i - 1];
+      if (u < width - 1 && !finite_mask[i + 1] && seeded[components.parent[i + 1]])
+        neighbors[nr_neighbors++] = components.parent[i + 1];
+      if (v > 0 && !finite_mask[i - width] && seeded[components.parent[i - width]])
+        neighbors[nr_neighbors++] = components.parent[i - width];
+      if (v < height - 1 && !finite_mask[i + width] && seeded[components.parent[i + width]])
+        neighbors[nr_neighbors++] = components.parent[i + width];
+      for (int n = 1; n < nr_neighbors; ++n)
+      {
+        components.unite (neighbors[0], neighbors[n]);
+      }
+    });
 
-            while (border_list_it != borders_list.end ())
-            {
-              std::set<Eigen::Vector2i, Vector2iComp>::const_iterator border_it = current_border.begin ();
-              while (border_it != current_border.end ())
-              {
-                if (border_list_it->find (*border_it) != border_list_it->end ())
-                {
-                  // add iterators at the front of the list with shared regions / border
-                  shared_border_list.push_front (border_list_it);
-                  shared_hole_list.push_front (hole_list_it);
-                  break;  // we already know border is shared - no need to check further
-                }
-                border_it++;
-              }
-              border_list_it++;
-              hole_list_it++;
-            }
+    // order the merged regions by their first seed
+    std::vector<std::pair<int, int> > region_seeds;
+    comp_it = seeded_components.begin ();
+    while (comp_it != seeded_components.end ())
+    {
+      int region = components.find (*comp_it);
+      first_seed[region] = std::min (first_seed[region], first_seed[*comp_it]);
+      comp_it++;
+    }
+    comp_it = seeded_components.begin ();
+    while (comp_it != seeded_components.end ())
+    {
+      if (components.find (*comp_it) == *comp_it)
+        region_seeds.push_back (std::pair<int, int> (first_seed[*comp_it], *comp_it));
+      comp_it++;
+    }
+    std::sort (region_seeds.begin (), region_seeds.end ());
+    for (size_t r = 0; r < region_seeds.size (); ++r)
+    {
+      region_index[region_seeds[r].second] = r;
+    }
 
-            // new region doesn't border any other region
-            if (shared_border_list.size () == 0)
+    // collect hole and border coordinates in column-major order (sorted w.r.t. Vector2iComp);
+    // the first pass counts the coordinates per region, the second one stores them
+    const size_t nr_regions = region_seeds.size ();
+    regions.hole_offsets.assign (nr_regions + 1, 0);
+    regions.border_offsets.assign (nr_regions + 1, 0);
+    regions.inside_counts.assign (nr_regions, 0);
+    regions.classes.assign (nr_regions, REGION_INSIDE);
+    std::vector<size_t> hole_cursors, border_cursors;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+      if (pass == 1)
+      {
+        for (size_t r = 0; r < nr_regions; ++r)
+        {
+          regions.hole_offsets[r + 1] += regions.hole_offsets[r];
+          regions.border_offsets[r + 1] += regions.border_offsets[r];
+        }
+        regions.hole_coords.resize (regions.hole_offsets.back ());
+        regions.border_coords.resize (regions.border_offsets.back ());
+        hole_cursors.assign (regions.hole_offsets.begin (), regions.hole_offsets.end () - 1);
+        border_cursors.assign (regions.border_offsets.begin (), regions.border_offsets.end () - 1);
+      }
+      forEachActivePixelColumnMajor (active_blocks, block_size, width, height, [&] (int u, int v, int i)
+      {
+        if (!finite_mask[i])
+        {
+          if (seeded[components.parent[i]])
+          {
+            int region = region_index[components.find (i)];
+            if (pass == 0)
             {
-              // insert new border / region at the end of existing lists
-              holes_list.push_back (current_hole);
-              borders_list.push_back (current_border);
+              regions.hole_offsets[region + 1]++;
+              regions.inside_counts[region] += table_mask[i];
             }
             else
             {
-              // TODO: might look somewhat ugly, but is there a nicer way to do the same?
-              // add current region / border to first detected neighbor (last element in shared lists)
-              std::list<std::list<std::set<Eigen::Vector2i, Vector2iComp> >::iterator>::const_iterator merge_border_it;
-              std::list<std::list<std::vector<Eigen::Vector2i> >::iterator>::const_iterator merge_hole_it;
-
-              merge_border_it = shared_border_list.end ();
-              merge_hole_it = shared_hole_list.end ();
-              merge_border_it--;
-              merge_hole_it--;
-
-              (*merge_border_it)->insert (current_border.begin (), current_border.end ());
-              (*merge_hole_it)->insert ((*merge_hole_it)->end (), current_hole.begin (), current_hole.end ());
-
-              // do we need to merge some other regions as well?
-              if (shared_border_list.size () > 1)
-              {
-                std::list<std::list<std::set<Eigen::Vector2i, Vector2iComp> >::iterator>::const_iterator shared_b_it;
-                std::list<std::list<std::vector<Eigen::Vector2i> >::iterator>::const_iterator shared_h_it;
-                shared_b_it = shared_border_list.begin ();
-                shared_h_it = shared_hole_list.begin ();
-
-                while (shared_b_it != merge_border_it)
-                {
-                  // add to border / hole to merge border / region
-                  (*merge_border_it)->insert ((*shared_b_it)->begin (), (*shared_b_it)->end ());
-                  (*merge_hole_it)->insert ((*merge_hole_it)->end (), (*shared_h_it)->begin (),
-                      (*shared_h_it)->end ());
-                  // delete old border / region
-                  borders_list.erase ((*shared_b_it));
-                  holes_list.erase ((*shared_h_it));
-                  // advance to next border / region to be merged
-                  shared_b_it++;
-                  shared_h_it++;
-                }
-              }
+              regions.hole_coords[hole_cursors[region]++] = Eigen::Vector2i (u, v);
             }
           }
+          return;
         }
-      }
+        // a border pixel is added once to each region it is adjacent to
+        int nr_neighbors = 0;
+        if (u > 0 && !finite_mask[i - 1] && seeded[components.parent[i - 1]])
+          neighbors[nr_neighbors++] = region_index[components.find (i - 1)];
+        if (u < width - 1 && !finite_mask[i + 1] && seeded[components.parent[i + 1]])
+          neighbors[nr_neighbors++] = region_index[components.find (i + 1)];
+        if (v > 0 && !finite_mask[i - width] && seeded[components.parent[i - width]])
+          neighbors[nr_neighbors++] = region_index[components.find (i - width)];
+        if (v < height - 1 && !finite_mask[i + width] && seeded[components.parent[i + width]])
+          neighbors[nr_neighbors++] = region_index[components.find (i + width)];
+        for (int n = 0; n < nr_neighbors; ++n)
+        {
+          if (std::find (neighbors, neighbors + n, neighbors[n]) != neighbors + n)
+            continue;
+          if (pass == 0)
+            regions.border_offsets[neighbors[n] + 1]++;
+          else
+            regions.border_coords[border_cursors[neighbors[n]]++] = Eigen::Vector2i (u, v);
+        }
+      });
     }
 
-  template <typename PointT>
-    static void collectNaNRegions (
-        boost::shared_ptr<const ::pcl::PointCloud<PointT> > &cloud,
-        const std::vector<Eigen::Vector2i> &hull_2Dcoords,
-        const Eigen::Vector2i &table_min,
-        const Eigen::Vector2i &table_max,
-        size_t min_region_size,
-        std::vector<std::vector<Eigen::Vector2i> > &all_hole_2Dcoords,
-        std::vector<std::vector<Eigen::Vector2i> > &all_border_2Dcoords)
+    // reset the buffer entries of the seeded components for the next frame
+    comp_it = seeded_components.begin ();
+    while (comp_it != seeded_components.end ())
     {
-      // clear output arguments
-      all_hole_2Dcoords.clear ();
-      all_border_2Dcoords.clear ();
-
-      // create local containers for temporary holes and borders
-      std::list<std::vector<Eigen::Vector2i> > all_holes_list;
-      std::list<std::set<Eigen::Vector2i, Vector2iComp> > all_borders_list;
-
-      iterativeNaNGrowing (cloud, hull_2Dcoords, table_min, table_max, all_holes_list, all_borders_list);
+      seeded[*comp_it] = 0;
+      first_seed[*comp_it] = std::numeric_limits<int>::max ();
+      region_index[*comp_it] = -1;
+      comp_it++;
+    }
+  }
 
-      // delete all regions that have less than 'min_region_size' points
-      std::list<std::vector<Eigen::Vector2i> >::iterator hole_it = all_holes_list.begin ();
-      std::list<std::set<Eigen::Vector2i, Vector2iComp> >::iterator border_it = all_borders_list.begin ();
-      while (hole_it != all_holes_list.end ())
+  /* Labels the NaN regions (see 'labelNaNRegions ()') and classifies them: regions
+   * with less than 'min_region_size' pixels are too small, regions without pixels
+   * outside of the table hull are inside, the remaining ones are outside if
+   * #outside > #inside * inside_out_factor and overlapping otherwise.
+   * For a 'pyramid_level' > 0 only the blocks (of size 2^pyramid_level) selected by
+   * 'selectActiveBlocks ()' are labeled at full resolution. This yields the same regions
+   * that are not too small, while the labeling of all irrelevant NaN pixels is skipped.
+   * See 'labelNaNRegions ()' for 'tile_size', 'nr_threads' and 'thread_pool'.
+   */
+  static void collectNaNRegions (
+      const ImageBuffer<char> &finite_mask,
+      const ImageBuffer<char> &table_mask,
+      const std::vector<Eigen::Vector3i> &table_spans,
+      size_t min_region_size,
+      float inside_out_factor,
+      size_t pyramid_level,
+      int tile_size,
+      size_t nr_threads,
+      ThreadPool &thread_pool,
+      NaNLabelingBuffers &buffers,
+      NaNRegions &regions)
+  {
+    const int width = finite_mask.width ();
+    const int height = finite_mask.height ();
+    if (pyramid_level == 0)
+    {
+      // a single block covering the complete image
+      buffers.active_blocks.resize (1, 1);
+      buffers.active_blocks.fill (1);
+      labelNaNRegions (finite_mask, table_mask, table_spans, buffers.active_blocks,
+          std::max (width, height), tile_size, nr_threads, thread_pool, buffers, regions);
+    }
+    else
+    {
+      const int block_size = 1 << pyramid_level;
+      size_t nr_active = selectActiveBlocks (finite_mask, table_mask, block_size, min_region_size, buffers);
+      ROS_DEBUG_STREAM_NAMED ("HoleDetector", "Pyramid mode: labeling " << nr_active << " of "
+          << buffers.active_blocks.size () << " blocks at full resolution");
+
+      // copy the active blocks of the finite mask into the pyramid mask, all other pixels
+      // of the pyramid mask are finite
+      ImageBuffer<char> &pyramid_mask = buffers.pyramid_mask;
+      pyramid_mask.resize (width, height, 1);
+      for (int v = 0; v < height; ++v)
       {
-        if (hole_it->size () < min_region_size)
-        {
-          hole_it = all_holes_list.erase (hole_it);
-          border_it = all_borders_list.erase (border_it);
-        }
-        else
+        const char *active_row = &buffers.active_blocks (0, v / block_size);
+        for (int block_u = 0; block_u < buffers.active_blocks.width (); ++block_u)
         {
-          hole_it++;
-          border_it++;
+          if (active_row[block_u])
+          {
+            const int u = block_u * block_size;
+            memcpy (&pyramid_mask (u, v), &finite_mask (u, v), std::min (block_size, width - u));
+          }
         }
       }
-      // convert lists to output arguments
-      all_hole_2Dcoords.reserve (all_holes_list.size ());
-      all_border_2Dcoords.reserve (all_borders_list.size ());
-      hole_it = all_holes_list.begin ();
-      border_it = all_borders_list.begin ();
-      while (hole_it != all_holes_list.end ())
+
+      labelNaNRegions (pyramid_mask, table_mask, table_spans, buffers.active_blocks,
+          block_size, tile_size, nr_threads, thread_pool, buffers, regions);
+
+      // reset the pyramid mask for the next frame
+      for (int v = 0; v < height; ++v)
       {
-        all_hole_2Dcoords.push_back (*hole_it);
-        all_border_2Dcoords.push_back (std::vector<Eigen::Vector2i> (border_it->begin (), border_it->end ()));
-        hole_it++;
-        border_it++;
+        const char *active_row = &buffers.active_blocks (0, v / block_size);
+        for (int block_u = 0; block_u < buffers.active_blocks.width (); ++block_u)
+        {
+          if (active_row[block_u])
+          {
+            const int u = block_u * block_size;
+            memset (&pyramid_mask (u, v), 1, std::min (block_size, width - u));
+          }
+        }
       }
     }
 
+    for (size_t r = 0; r < regions.size (); ++r)
+    {
+      size_t inside = regions.inside_counts[r];
+      size_t outside = regions.nrHolePixels (r) - inside;
+      if (regions.nrHolePixels (r) < min_region_size)
+        regions.classes[r] = REGION_TOO_SMALL;
+      // TODO: probably some fraction dependent on min_hole_size_ should be used
+      else if (outside > 0)
+        regions.classes[r] = outside > inside * inside_out_factor ? REGION_OUTSIDE : REGION_OVERLAP;
+      else
+        regions.classes[r] = REGION_INSIDE;
+    }
+  }
+
   template <typename PointT>
     static bool convertIndexTo2DCoords (
         boost::shared_ptr<const ::pcl::PointCloud<PointT> > &cloud,
@@ -718,135 +1163,316 @@ struct HoleDetector
       fused_hull_clouds.clear ();
       hull_cluster_coords.clear ();
 
-      // compute bounding boxes for all borders
+      // compute bounding boxes for all borders and convert the hulls once for the distance checks
       std::vector<Eigen::Vector4f> min_bboxes, max_bboxes;
+      std::vector<std::vector<Eigen::Vector3f> > hull_polygons (all_hulls.size ());
       min_bboxes.reserve (all_hulls.size ());
       max_bboxes.reserve (all_hulls.size ());
       Eigen::Vector4f min_bbox, max_bbox;
-      size_t total_hull_points = 0;
       for (size_t i = 0; i < all_hulls.size (); ++i)
       {
         ::pcl::getMinMax3D<PointT> (*all_hulls[i], min_bbox, max_bbox);
         min_bboxes.push_back (min_bbox);
         max_bboxes.push_back (max_bbox);
-        total_hull_points += all_hulls[i]->points.size ();
+        convert<PointT> (all_hulls[i], hull_polygons[i]);
       }
 
-      float max_fusion_dist2 = max_fusion_dist * max_fusion_dist;
-      bool detected_set;
-      std::pair<std::set<size_t>::iterator, bool> insert_res;
-      std::vector<int> cluster_correspondence (all_hulls.size (), -1);
+      // sweep and prune: sort the hulls w.r.t. the lower x-bound of their bboxes; only hulls
+      // whose bboxes (extended by the fusion distance) overlap in x can be close enough
+      std::vector<size_t> sweep_order (all_hulls.size ());
+      for (size_t i = 0; i < sweep_order.size (); ++i)
+      {
+        sweep_order[i] = i;
+      }
+      std::sort (sweep_order.begin (), sweep_order.end (),
+          [&min_bboxes] (size_t a, size_t b)
+          {
+            return min_bboxes[a][0] < min_bboxes[b][0] ||
+              (min_bboxes[a][0] == min_bboxes[b][0] && a < b);
+          });
 
-      size_t nr_clusters = 0;
-      int next_cluster_nr = 0;
-      int c_index;
+      float max_fusion_dist2 = max_fusion_dist * max_fusion_dist;
+      UnionFind hull_clusters;
+      hull_clusters.resize (all_hulls.size ());
       for (size_t i = 0; i < all_hulls.size (); ++i)
       {
-        // retrieve the current hull
-        boost::shared_ptr<const ::pcl::PointCloud<PointT> > curr_hull = all_hulls[i];
-        // check if current hull isn't part of any cluster yet
-        if (cluster_correspondence[i] == -1)
-        {
-          cluster_correspondence[i] = next_cluster_nr++;
-          nr_clusters++;
-        }
-        c_index = cluster_correspondence[i];
-        for (size_t j = i + 1; j < all_hulls.size (); ++j)
+        hull_clusters.makeSet (i);
+      }
+
+      for (size_t s = 0; s < sweep_order.size (); ++s)
+      {
+        float sweep_end = max_bboxes[sweep_order[s]][0] + max_fusion_dist;
+        for (size_t t = s + 1; t < sweep_order.size () && min_bboxes[sweep_order[t]][0] <= sweep_end; ++t)
         {
+          // always compare in the order of the hull indices
+          size_t i = std::min (sweep_order[s], sweep_order[t]);
+          size_t j = std::max (sweep_order[s], sweep_order[t]);
           // check if compared hull isn't already in the same cluster
-          if (c_index != cluster_correspondence[j])
-          {
-            // retrieve the hull to compare with
-            boost::shared_ptr<const ::pcl::PointCloud<PointT> > compare_hull = all_hulls[j];
+          if (hull_clusters.find (i) == hull_clusters.find (j))
+            continue;
 
-            // first check if bounding boxes are close enough (necessary criteria)
-            float bbox_dist = holeBorderLowerBoundDist2 (min_bboxes[i], max_bboxes[i],
-                min_bboxes[j], max_bboxes[j]);
-            if (max_fusion_dist2 > bbox_dist)
+          // first check if bounding boxes are close enough (necessary criteria)
+          float bbox_dist = holeBorderLowerBoundDist2 (min_bboxes[i], max_bboxes[i],
+              min_bboxes[j], max_bboxes[j]);
+          if (max_fusion_dist2 > bbox_dist)
+          {
+            // check if the hulls intersect or are close enough
+            if (convexHullDistBelowThreshold (hull_polygons[i], hull_polygons[j], max_fusion_dist))
             {
-              bool fuse = false;
-              // check if the hulls intersect
-              if (bbox_dist <= 2.0f * std::numeric_limits<float>::epsilon ())
-              {
-                // TODO: hulls could once all be converted to speed up doConvexHulls2DIntersect ()
-                fuse = doConvexHulls2DIntersect<PointT> (curr_hull, compare_hull);
-              }
-              if (!fuse)  // if hulls don't overlap, check if they are close enough
-              {
-                fuse =  convexHullDistBelowThreshold<PointT> (curr_hull, compare_hull, max_fusion_dist);
-              }
-              if (fuse) // intersect or close enough
-              {
-                // is the hull that is to be fused already part of another cluster?
-                if (cluster_correspondence[j] != -1)
-                {
-                  // add the current hull and all other hulls from the same cluster to the cluster of the compared hull
-                  int fusion_index = cluster_correspondence[j];
-                  for (size_t k = 0; k < cluster_correspondence.size (); ++k)
-                  {
-                    if (cluster_correspondence[k] == c_index)
-                    {
-                      cluster_correspondence[k] = fusion_index;
-                    }
-                  }
-                  c_index = fusion_index;
-                  nr_clusters--;
-                }
-                else
-                {
-                  // add compare hull to cluster of current hull
-                  cluster_correspondence[j] = c_index;
-                }
-              } // else: hulls are farther apart than threshold
-            } //  else: bounding boxes are farther apart than threshold
-          } // hulls are already in the same cluster
-        } // checked current hull against all other hulls for fusion - investigate next hull
-      }
-
-      // determine how many clusters exist
-      std::vector<int>::const_iterator c_index_it = cluster_correspondence.begin ();
-      std::set<int> cluster_nr_set;
-      while (c_index_it != cluster_correspondence.end ())
-      {
-        cluster_nr_set.insert (*c_index_it++);
-      }
-      fused_hull_clouds.reserve (cluster_nr_set.size ());
-      hull_cluster_coords.reserve (cluster_nr_set.size ());
-      std::set<int>::const_iterator set_it = cluster_nr_set.begin ();
-      // aggregate points and 2D coords of convex hulls in the same cluster
-      while (set_it != cluster_nr_set.end ())
-      {
-        auto current_hull_cluster = boost::make_shared<::pcl::PointCloud<PointT> > ();
-        std::vector<Eigen::Vector2i> current_hull_cluster_coords;
-        current_hull_cluster->points.reserve (total_hull_points);
-        current_hull_cluster_coords.reserve (total_hull_points);
-        size_t last_cluster_member_hull;
-        for (size_t i = 0; i < cluster_correspondence.size (); ++i)
+              hull_clusters.unite (i, j);
+            }
+          } //  else: bounding boxes are farther apart than threshold
+        }
+      }
+
+      // assign an output index to each cluster (clusters are ordered by their first hull,
+      // which is the representative of the cluster) and determine the cluster sizes
+      std::vector<int> cluster_index (all_hulls.size (), -1);
+      std::vector<size_t> cluster_points, cluster_coords;
+      for (size_t i = 0; i < all_hulls.size (); ++i)
+      {
+        int root = hull_clusters.find (i);
+        if (cluster_index[root] == -1)
         {
-          if (cluster_correspondence[i] == *set_it)
-          {
-            current_hull_cluster->points.insert (current_hull_cluster->points.end (),
-                all_hulls[i]->points.begin (), all_hulls[i]->points.end ());
-            current_hull_cluster_coords.insert (current_hull_cluster_coords.end (),
-                remaining_hull_coords[i].begin (), remaining_hull_coords[i].end ());
-            last_cluster_member_hull = i;
-          }
+          cluster_index[root] = cluster_points.size ();
+          cluster_points.push_back (0);
+          cluster_coords.push_back (0);
         }
-        // add aggregated points / 2D coords to output arguments
-        current_hull_cluster->header = all_hulls[last_cluster_member_hull]->header;
-        fused_hull_clouds.push_back (current_hull_cluster);
-        hull_cluster_coords.push_back (current_hull_cluster_coords);
-        set_it++;
+        cluster_points[cluster_index[root]] += all_hulls[i]->points.size ();
+        cluster_coords[cluster_index[root]] += remaining_hull_coords[i].size ();
+      }
+      fused_hull_clouds.resize (cluster_points.size ());
+      hull_cluster_coords.resize (cluster_points.size ());
+      for (size_t c = 0; c < cluster_points.size (); ++c)
+      {
+        fused_hull_clouds[c] = boost::make_shared<::pcl::PointCloud<PointT> > ();
+        fused_hull_clouds[c]->points.reserve (cluster_points[c]);
+        hull_cluster_coords[c].reserve (cluster_coords[c]);
       }
-    }
 
-  static void declare_params (tendrils& params)
-  {
-    params.declare<size_t> ("min_hole_size", "Minimal numbers of connected pixels in the depth image to form a hole", 15);
-    params.declare<float> ("inside_out_factor", "Determines if a nan-region is outside of table hull (#outside > #points_inside * inside_out_factor)", 2.0f);
-    params.declare<float> ("plane_dist_threshold", "Distance threshold for plane classification", .02f);
-    params.declare<float> ("min_distance_to_convex_hull", "Minimal distance to convex hull for overlapping holes", .05f);
-  }
+      // aggregate points and 2D coords of convex hulls in the same cluster
+      for (size_t i = 0; i < all_hulls.size (); ++i)
+      {
+        int c = cluster_index[hull_clusters.find (i)];
+        fused_hull_clouds[c]->points.insert (fused_hull_clouds[c]->points.end (),
+            all_hulls[i]->points.begin (), all_hulls[i]->points.end ());
+        hull_cluster_coords[c].insert (hull_cluster_coords[c].end (),
+            remaining_hull_coords[i].begin (), remaining_hull_coords[i].end ());
+        fused_hull_clouds[c]->header = all_hulls[i]->header;  // header of last cluster member
+      }
+    }
+
+  /* Computes the convex hull of the eroded border of NaN region 'r', projected into the
+   * table plane. Overlapping regions are only considered if their border inside the table
+   * hull is close to the table plane and far enough from the hull of the table. Returns
+   * false if the region is discarded, which includes hulls that touch the image border.
+   */
+  template <typename PointT>
+    bool computeRegionHull (boost::shared_ptr<const ::pcl::PointCloud<PointT> > &input, size_t r,
+        const boost::shared_ptr<::pcl::PointCloud<PointT> > &table_convex_hull,
+        const Eigen::Vector4f &plane_coefficients,
+        boost::shared_ptr<::pcl::PointCloud<PointT> > &hull_cloud,
+        std::vector<Eigen::Vector2i> &hull_coords)
+    {
+      if (nan_regions_.classes[r] == REGION_OVERLAP)
+      {
+        // first retrieve the 3D points from the extracted border, project into plane and distinguish which are inside the table convex hull
+        auto extracted_border_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
+        auto inside_hull_border = boost::make_shared<::pcl::PointCloud<PointT> > ();
+        extracted_border_cloud->points.reserve (nan_regions_.nrBorderPixels (r));
+        inside_hull_border->points.reserve (nan_regions_.nrBorderPixels (r));
+        if (prepare_points_)
+        {
+          prepare_points_ (nan_regions_.borderBegin (r), nan_regions_.borderEnd (r));
+        }
+        PointT projection;
+        double dist_sum = 0.0f;
+        const Eigen::Vector2i *coord_it = nan_regions_.borderBegin (r);
+        while (coord_it != nan_regions_.borderEnd (r))
+        {
+          if (projectPointOnPlane<PointT> (input->at ((*coord_it)[0], (*coord_it)[1]), projection, plane_coefficients))
+          {
+            extracted_border_cloud->points.push_back (projection);
+            if (table_mask_ ((*coord_it)[0], (*coord_it)[1]))
+            {
+              dist_sum += ::pcl::pointToPlaneDistance (input->at ((*coord_it)[0], (*coord_it)[1]), plane_coefficients);
+              inside_hull_border->points.push_back (projection);
+            }
+          }
+          // otherwise discard the point
+          coord_it++;
+        }
+        // set dimension
+        extracted_border_cloud->width = extracted_border_cloud->points.size ();
+        extracted_border_cloud->height = 1;
+        inside_hull_border->width = inside_hull_border->points.size ();
+        inside_hull_border->height = 1;
+
+        double avg_dist = dist_sum / static_cast<double> (inside_hull_border->points.size ());
+        if (avg_dist > *plane_dist_threshold_ * 3.0f) // TODO: perhaps remove the points with the largest 3 distances instead?
+        {
+          //skip hole! should something more be done?
+          return false;
+        }
+
+        if (extracted_border_cloud->points.size () == 0 ||
+            !minDistAboveThreshold (table_convex_hull, inside_hull_border, *min_distance_to_convex_hull_))
+        {
+          return false;
+        }
+      }
+      // TODO: only compute the average distance from border points to idealized table plane
+      // for those points that belong to the outside border and not to potentially spurious
+      // measurement points that are enclosed by the convex hull (for the inside regions)
+
+      // erode border cloud
+      auto border_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
+      erodeBorder (input, finite_mask_, nan_regions_.borderBegin (r), nan_regions_.borderEnd (r),
+          eroded_border_coords_, border_cloud, 2);
+
+      // project border into plane and retrieve convex hull
+      ::pcl::PointIndices conv_border_indices;
+      projectBorderAndCreateHull (border_cloud, hull_cloud, conv_border_indices);
+
+      hull_coords.clear ();
+      hull_coords.reserve (conv_border_indices.indices.size ());
+      std::vector<int>::const_iterator hull_it = conv_border_indices.indices.begin ();
+      while (hull_it != conv_border_indices.indices.end ())
+      {
+        hull_coords.push_back (eroded_border_coords_[*hull_it++]);
+      }
+      // check if hole touches border, these are discarded
+      bool touches_border;
+      Eigen::Vector2i min_bbox, max_bbox;
+      get2DHullBBox (input, hull_coords, min_bbox, max_bbox, touches_border);
+      return !touches_border;
+    }
+
+  /* Checks if NaN region 'r' equals the cached region of the previous frame that starts at
+   * the same pixel: both need the same class and number of pixels, and none of the tiles
+   * covered by the region (plus margin) may have changed in the finite mask or the table
+   * mask. The hull of an overlapping region also depends on the complete table hull.
+   */
+  bool regionUnchanged (size_t r, const CachedRegionHull &entry, bool table_hull_unchanged) const
+  {
+    if (entry.region_class != nan_regions_.classes[r] ||
+        entry.nr_hole_pixels != nan_regions_.nrHolePixels (r) ||
+        entry.nr_border_pixels != nan_regions_.nrBorderPixels (r))
+      return false;
+    if (entry.region_class == REGION_OVERLAP && !table_hull_unchanged)
+      return false;
+
+    Eigen::Vector2i min = *nan_regions_.holeBegin (r);
+    Eigen::Vector2i max = min;
+    for (const Eigen::Vector2i *it = nan_regions_.holeBegin (r); it != nan_regions_.holeEnd (r); ++it)
+    {
+      min = min.cwiseMin (*it);
+      max = max.cwiseMax (*it);
+    }
+    for (const Eigen::Vector2i *it = nan_regions_.borderBegin (r); it != nan_regions_.borderEnd (r); ++it)
+    {
+      min = min.cwiseMin (*it);
+      max = max.cwiseMax (*it);
+    }
+    Eigen::Vector2i min_tile, max_tile;
+    for (size_t i = 0; i < 2; ++i)
+    {
+      int nr_tiles = i == 0 ? changed_mask_tiles_.width () : changed_mask_tiles_.height ();
+      min_tile[i] = std::max (min[i] - TEMPORAL_TILE_MARGIN, 0) / TEMPORAL_TILE_SIZE;
+      max_tile[i] = std::min ((max[i] + TEMPORAL_TILE_MARGIN) / TEMPORAL_TILE_SIZE, nr_tiles - 1);
+    }
+    for (int v = min_tile[1]; v <= max_tile[1]; ++v)
+    {
+      for (int u = min_tile[0]; u <= max_tile[0]; ++u)
+      {
+        if (changed_mask_tiles_ (u, v) || changed_table_tiles_ (u, v))
+          return false;
+      }
+    }
+    return true;
+  }
+
+  /* Checks if the normals of two plane models differ by less than half a degree and their
+   * distances to the origin by less than 'max_offset'.
+   */
+  static bool similarPlanes (const std::vector<float> &plane_a, const std::vector<float> &plane_b,
+      float max_offset)
+  {
+    if (plane_a.size () < 4 || plane_b.size () < 4)
+      return false;
+    Eigen::Vector3f normal_a (plane_a[0], plane_a[1], plane_a[2]);
+    Eigen::Vector3f normal_b (plane_b[0], plane_b[1], plane_b[2]);
+    float norm_a = normal_a.norm ();
+    float norm_b = normal_b.norm ();
+    if (norm_a == 0.0f || norm_b == 0.0f)
+      return false;
+    float cos_angle = normal_a.dot (normal_b) / (norm_a * norm_b);
+    float offset_a = plane_a[3] / norm_a;
+    float offset_b = plane_b[3] / norm_b;
+    // the orientation of the normals is arbitrary
+    if (cos_angle < 0.0f)
+    {
+      cos_angle = -cos_angle;
+      offset_b = -offset_b;
+    }
+    return cos_angle > cos (::pcl::deg2rad (.5f)) && fabs (offset_a - offset_b) < max_offset;
+  }
+
+  /* Sets the output cloud, i.e., the input without the points given by 'remove_indices'. */
+  template <typename PointT>
+    void setOutputCloud (boost::shared_ptr<const ::pcl::PointCloud<PointT> > &input,
+        const ::pcl::PointIndices::ConstPtr &remove_indices)
+    {
+      // TODO: do we still need the filtered point cloud as output?
+      // set all points in the point cloud to nan, if their index was contained in remove_indices
+      if (*nan_mark_output_)
+      {
+        // copy the input only if there is something to remove
+        if (remove_indices->indices.empty ())
+        {
+          *output_ = ecto::pcl::xyz_cloud_variant_t (input);
+        }
+        else
+        {
+          auto filtered_cloud = boost::make_shared<::pcl::PointCloud<PointT> > (*input);
+          std::vector<int>::const_iterator index_it = remove_indices->indices.begin ();
+          while (index_it != remove_indices->indices.end ())
+          {
+            PointT &p = filtered_cloud->points[*index_it++];
+            p.x = p.y = p.z = std::numeric_limits<float>::quiet_NaN ();
+          }
+          filtered_cloud->is_dense = false;
+          *output_ = ecto::pcl::xyz_cloud_variant_t (filtered_cloud);
+        }
+      }
+      else
+      {
+        typename ::pcl::ExtractIndices<PointT> extractor;
+        auto filtered_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
+        extractor.setKeepOrganized (true);
+        extractor.setNegative (true);
+        extractor.setInputCloud (input);
+        extractor.setIndices (remove_indices);
+        extractor.filter (*filtered_cloud);
+        *output_ = ecto::pcl::xyz_cloud_variant_t (filtered_cloud);
+      }
+    }
+
+  static void declare_params (tendrils& params)
+  {
+    params.declare<size_t> ("min_hole_size", "Minimal numbers of connected pixels in the depth image to form a hole", 15);
+    params.declare<float> ("inside_out_factor", "Determines if a nan-region is outside of table hull (#outside > #points_inside * inside_out_factor)", 2.0f);
+    params.declare<float> ("plane_dist_threshold", "Distance threshold for plane classification", .02f);
+    params.declare<float> ("min_distance_to_convex_hull", "Minimal distance to convex hull for overlapping holes", .05f);
+    params.declare<bool> ("nan_mark_output", "Create the output cloud by setting the removed points of a copy of the input to NaN (the input is passed through if nothing is removed) instead of using pcl::ExtractIndices", false);
+    params.declare<size_t> ("pyramid_level", "Label the NaN regions only inside blocks of size 2^pyramid_level that are part of coarse NaN components large enough to contain a hole (0 labels the complete image)", 0);
+    params.declare<int> ("labeling_tile_size", "Edge length of the image tiles that are labeled in parallel", 128);
+    params.declare<size_t> ("labeling_threads", "Number of threads for the labeling of the NaN regions (1 labels the image serially, 0 uses one thread per core)", 1);
+    params.declare<bool> ("pipelined", "Label the NaN regions of each frame on a second thread while the holes of the previous frame are built; the outputs are delayed by one frame (not supported by DepthHoleDetector and not combined with temporal_tracking)", false);
+    params.declare<bool> ("temporal_tracking", "Reuse the holes and hulls of the previous frame for the parts of the NaN mask that did not change (the hulls of reused regions are not updated with the new measurements)", false);
+    params.declare<std::string> ("table_frame", "If set, the transforms from the sensor frame into this frame and from it into map_frame are embedded into compact_holes (only if tf already provides them when the frame is processed, the intersector waits for missing ones via tf)", "");
+    params.declare<std::string> ("map_frame", "Map frame for the embedded transforms (no table to map transform is embedded if empty or equal to table_frame)", "");
+  }
 
   static void declare_io ( const tendrils& params, tendrils& inputs, tendrils& outputs)
   {
@@ -854,282 +1480,401 @@ struct HoleDetector
     inputs.declare<::pcl::ModelCoefficients::ConstPtr> ("model", "Model coefficients for the planar table surface.");
     outputs.declare<ecto::pcl::PointCloud> ("output", "Filtered Cloud.");
     outputs.declare<transparent_object_reconstruction::Holes::ConstPtr> ("holes", "Detected holes inside the table convex hull.");
+    outputs.declare<transparent_object_reconstruction::CompactHoles::ConstPtr> ("compact_holes", "Detected holes inside the table convex hull, packed into a single vertex array.");
     outputs.declare<::pcl::PointIndices::ConstPtr> ("remove_indices", "Indices of points inside the detected holes.");
   }
 
   void configure( const tendrils& params, const tendrils& inputs, const tendrils& outputs)
+  {
+    configureDetection (params, inputs, outputs);
+    output_ = outputs["output"];
+  }
+
+  /* Binds the parameters and the tendrils shared with DepthHoleDetector. */
+  void configureDetection (const tendrils& params, const tendrils& inputs, const tendrils& outputs)
   {
     min_hole_size_ = params["min_hole_size"];
     inside_out_factor_ = params["inside_out_factor"];
     plane_dist_threshold_ = params["plane_dist_threshold"];
     min_distance_to_convex_hull_ = params["min_distance_to_convex_hull"];
+    nan_mark_output_ = params["nan_mark_output"];
+    pyramid_level_ = params["pyramid_level"];
+    labeling_tile_size_ = params["labeling_tile_size"];
+    labeling_threads_ = params["labeling_threads"];
+    pipelined_ = params["pipelined"];
+    temporal_tracking_ = params["temporal_tracking"];
+    table_frame_ = params["table_frame"];
+    map_frame_ = params["map_frame"];
     hull_indices_ = inputs["hull_indices"];
     model_ = inputs["model"];
-    output_ = outputs["output"];
     holes_mgs_ = outputs["holes"];
+    compact_holes_ = outputs["compact_holes"];
     remove_indices_ = outputs["remove_indices"];
+    thread_pool_ = boost::make_shared<ThreadPool> (resolveNrThreads (*labeling_threads_));
+    if (!table_frame_->empty ())
+    {
+      tf_listener_ = boost::make_shared<tf::TransformListener> ();
+    }
   }
 
   template <typename PointT>
     int process( const tendrils& inputs, const tendrils& outputs,
         boost::shared_ptr<const ::pcl::PointCloud<PointT> >& input)
     {
-      Eigen::Vector3f plane_normal = Eigen::Vector3f ((*model_)->values[0],
-          (*model_)->values[1], (*model_)->values[2]);
-
-      Eigen::Vector2i table_min, table_max;
-      std::vector<Eigen::Vector2i> hull_2Dcoords;
-      std::vector<std::vector<Eigen::Vector2i> > all_hole_2Dcoords;
-      std::vector<std::vector<Eigen::Vector2i> > all_border_2Dcoords;
-      getBoundingBox2DConvexHull (input, **hull_indices_, table_min, table_max, hull_2Dcoords);
+      if (*pipelined_)
+      {
+        processPipelined (input);
+        embedTransforms ();
+        return ecto::OK;
+      }
+      labeled_input_ = ecto::pcl::xyz_cloud_variant_t ();
 
-      // retrieve the 3D coordinates of the convex hull of the tabletop
-      auto table_convex_hull = boost::make_shared<::pcl::PointCloud<PointT> > ();
-      table_convex_hull->points.reserve ((*hull_indices_)->indices.size ());
-      std::vector<int>::const_iterator hull_index_it = (*hull_indices_)->indices.begin ();
-      while (hull_index_it != (*hull_indices_)->indices.end ())
+      // determine once which points are finite, all topology queries work on this mask
+      // (the temporal mode keeps the mask of the previous frame)
+      if (*temporal_tracking_)
       {
-        table_convex_hull->points.push_back (input->points[*hull_index_it++]);
+        finite_mask_.swap (previous_finite_mask_);
       }
-      table_convex_hull->width = table_convex_hull->points.size ();
-      table_convex_hull->height = 1;
+      computeFiniteMask (*input, finite_mask_);
 
-      std::vector<std::vector<bool> > visited (input->width, std::vector<bool> (input->height, false));
+      detectHoles (input);
+      setOutputCloud (input, *remove_indices_);
+      embedTransforms ();
+
+      return ecto::OK;
+    }
+
+  /* Embeds the transforms from the sensor frame into the table frame and from the table
+   * frame into the map frame at the time of the holes into the output 'compact_holes', so
+   * that consumers don't need to wait for tf. Only done if 'table_frame' is set.
+   */
+  void embedTransforms ()
+  {
+    if (!tf_listener_)
+      return;
 
-      // iterative region growing
-      size_t min_region_size = 15;
-      collectNaNRegions (input, hull_2Dcoords, table_min, table_max, min_region_size,
-          all_hole_2Dcoords, all_border_2Dcoords);
-      ROS_DEBUG_STREAM_NAMED ("HoleDetector", "iterativeNaNGrowing and filtering min_size "
-          << min_region_size << " resulted in " << all_hole_2Dcoords.size () << " regions");
+    auto compact_holes = boost::make_shared<transparent_object_reconstruction::CompactHoles> (**compact_holes_);
+    lookupTransform (*table_frame_, compact_holes->header.frame_id, compact_holes->header.stamp,
+        compact_holes->sensor_to_table);
+    if (!map_frame_->empty () && *map_frame_ != *table_frame_)
+    {
+      lookupTransform (*map_frame_, *table_frame_, compact_holes->header.stamp,
+          compact_holes->table_to_map);
+    }
+    *compact_holes_ = compact_holes;
+  }
 
-      /*
-      for (int u = table_min[0]; u < table_max[0]; ++u)
+  /* Retrieves the transform from 'source_frame' into 'target_frame' at the given time
+   * without waiting for it, thus the ecto thread never blocks. The transform is left
+   * untouched if it's not available yet, the intersector then waits for it via tf.
+   */
+  bool lookupTransform (const std::string &target_frame, const std::string &source_frame,
+      const ros::Time &stamp, geometry_msgs::TransformStamped &transform)
+  {
+    std::string error_msg;
+    if (!tf_listener_->canTransform (target_frame, source_frame, stamp, &error_msg))
+    {
+      // tf usually lags the sensor, thus this is the common case and not worth a warning
+      ROS_DEBUG_STREAM_NAMED ("HoleDetector", "Transform from " << source_frame << " into "
+          << target_frame << " not available yet, not embedded: " << error_msg);
+      return false;
+    }
+    tf::StampedTransform tf_transform;
+    try
+    {
+      tf_listener_->lookupTransform (target_frame, source_frame, stamp, tf_transform);
+    }
+    catch (tf::TransformException &ex)
+    {
+      ROS_WARN_STREAM_NAMED ("HoleDetector", "Transform from " << source_frame << " into "
+          << target_frame << " unavailable, not embedded: " << ex.what ());
+      return false;
+    }
+    tf::transformStampedTFToMsg (tf_transform, transform);
+    return true;
+  }
+
+  /* The pipelined mode: the new frame is labeled on a second thread into 'pending_frame_'
+   * while the holes of the previously labeled frame are built on the calling thread. The
+   * outputs thus belong to the previous frame (the first frame yields no holes and passes
+   * the input through). The temporal mode is not used here.
+   */
+  template <typename PointT>
+    void processPipelined (boost::shared_ptr<const ::pcl::PointCloud<PointT> > &input)
+    {
+      if (*temporal_tracking_)
+      {
+        ROS_WARN_ONCE_NAMED ("HoleDetector", "temporal_tracking is ignored in the pipelined mode");
+      }
+      previous_holes_.reset ();
+      hull_cache_.clear ();
+
+      pending_frame_.input = ecto::pcl::xyz_cloud_variant_t (input);
+      pending_frame_.model = *model_;
+      ::pcl::PointIndices::ConstPtr hull_indices = *hull_indices_;
+      std::thread labeling_thread ([&] ()
+      {
+        labelFrame (input, *hull_indices, pending_frame_);
+      });
+
+      try
       {
-        for (int v = table_min[1]; v < table_max[1]; ++v)
+        const boost::shared_ptr<const ::pcl::PointCloud<PointT> > *labeled_input =
+          boost::get<boost::shared_ptr<const ::pcl::PointCloud<PointT> > > (&labeled_input_);
+        if (labeled_input != NULL && *labeled_input)
         {
-          if (!visited[u][v] &&                                             // already used?
-              pointInPolygon2D (hull_2Dcoords, Eigen::Vector2i (u, v)) &&   // inside hull?
-              !(pcl::isFinite (input->at (u,v))))                           // nan point?
-          {
-            std::vector<Eigen::Vector2i> hole_2Dcoords;
-            std::vector<Eigen::Vector2i> border_2Dcoords;
-            recursiveNANGrowing (input, u, v, hole_2Dcoords, border_2Dcoords, visited);
-            if (hole_2Dcoords.size () > *min_hole_size_)
-            {
-              all_hole_2Dcoords.push_back (hole_2Dcoords);
-              all_border_2Dcoords.push_back (border_2Dcoords);
-            }
-          }
+          boost::shared_ptr<const ::pcl::PointCloud<PointT> > previous_input = *labeled_input;
+          buildHoles (previous_input, false);
+          setOutputCloud (previous_input, *remove_indices_);
         }
+        else
+        {
+          *holes_mgs_ = boost::make_shared<transparent_object_reconstruction::Holes> ();
+          auto compact_holes = boost::make_shared<transparent_object_reconstruction::CompactHoles> ();
+          compact_holes->header = pcl_conversions::fromPCL (input->header);
+          *compact_holes_ = compact_holes;
+          *remove_indices_ = boost::make_shared<::pcl::PointIndices> ();
+          setOutputCloud (input, *remove_indices_);
+        }
+      }
+      catch (...)
+      {
+        labeling_thread.join ();
+        throw;
       }
-      */
+      labeling_thread.join ();
+
+      // the pending frame becomes the current one
+      std::swap (labeled_input_, pending_frame_.input);
+      model_coefficients_.swap (pending_frame_.model);
+      table_hull_coords_.swap (pending_frame_.table_hull_coords);
+      finite_mask_.swap (pending_frame_.finite_mask);
+      table_mask_.swap (pending_frame_.table_mask);
+      table_spans_.swap (pending_frame_.table_spans);
+      std::swap (nan_regions_, pending_frame_.regions);
+    }
 
-      // collected all nan-regions that contain at least 1 nan-pixel inside the convex hull of the table
-      std::vector<std::vector<Eigen::Vector2i> >::const_iterator all_holes_it;
-      std::vector<std::vector<Eigen::Vector2i> >::const_iterator all_borders_it;
-      std::vector<Eigen::Vector2i>::const_iterator hole_it;
-      all_holes_it = all_hole_2Dcoords.begin ();
-      all_borders_it = all_border_2Dcoords.begin ();
-
-      std::vector<std::vector<Eigen::Vector2i> > outside_holes;
-      std::vector<std::vector<Eigen::Vector2i> > outside_borders;
-      std::vector<std::vector<Eigen::Vector2i> > overlap_holes;
-      std::vector<std::vector<Eigen::Vector2i> > overlap_borders;
-      std::vector<std::vector<Eigen::Vector2i> > inside_holes;
-      std::vector<std::vector<Eigen::Vector2i> > inside_borders;
-
-      outside_holes.reserve (all_hole_2Dcoords.size ());
-      outside_borders.reserve (all_hole_2Dcoords.size ());
-      overlap_holes.reserve (all_hole_2Dcoords.size ());
-      overlap_borders.reserve (all_hole_2Dcoords.size ());
-      inside_holes.reserve (all_hole_2Dcoords.size ());
-      inside_borders.reserve (all_hole_2Dcoords.size ());
-
-      size_t inside, outside;
-
-      while (all_holes_it != all_hole_2Dcoords.end ())
-      {
-        inside = outside = 0;
-        hole_it = all_holes_it->begin ();
-        while (hole_it != all_holes_it->end ())
+  /* Computes the finite mask, the table mask and the NaN regions of a frame into 'frame'.
+   * Besides 'frame' only the labeling buffers of the cell are used.
+   */
+  template <typename PointT>
+    void labelFrame (boost::shared_ptr<const ::pcl::PointCloud<PointT> > &input,
+        const ::pcl::PointIndices &hull_indices, FrameState &frame)
+    {
+      computeFiniteMask (*input, frame.finite_mask);
+      Eigen::Vector2i table_min, table_max;
+      getBoundingBox2DConvexHull (input, hull_indices, table_min, table_max, frame.table_hull_coords);
+      rasterizeTableHull (frame.table_hull_coords, input->width, input->height,
+          frame.table_mask, frame.table_spans);
+      collectFrameRegions (frame.finite_mask, frame.table_mask, frame.table_spans, frame.regions);
+    }
+
+  /* Labels and classifies the NaN regions with the parameters of the cell. Only this
+   * method uses 'thread_pool_', thus in the pipelined mode it's used by the labeling
+   * thread alone.
+   */
+  void collectFrameRegions (const ImageBuffer<char> &finite_mask, const ImageBuffer<char> &table_mask,
+      const std::vector<Eigen::Vector3i> &table_spans, NaNRegions &regions)
+  {
+    // iterative region growing
+    size_t min_region_size = 15;
+    collectNaNRegions (finite_mask, table_mask, table_spans, min_region_size,
+        *inside_out_factor_, *pyramid_level_, *labeling_tile_size_, *labeling_threads_,
+        *thread_pool_, labeling_buffers_, regions);
+  }
+
+  /* Detects the holes in the table top given the finite mask of the input and sets the
+   * outputs 'holes', 'compact_holes' and 'remove_indices'. Points of the input are only
+   * read at pixels that were passed to 'prepare_points_' before (if set).
+   */
+  template <typename PointT>
+    void detectHoles (boost::shared_ptr<const ::pcl::PointCloud<PointT> > &input)
+    {
+      model_coefficients_ = *model_;
+      Eigen::Vector2i table_min, table_max;
+      getBoundingBox2DConvexHull (input, **hull_indices_, table_min, table_max, table_hull_coords_);
+
+      // likewise for the pixels inside the convex hull of the table
+      rasterizeTableHull (table_hull_coords_, input->width, input->height, table_mask_, table_spans_);
+
+      // in the temporal mode, determine the tiles in which the finite mask or the table mask
+      // changed since the previous frame; the results of unchanged regions are reused
+      use_hull_cache_ = false;
+      table_hull_unchanged_ = false;
+      nr_changed_tiles_ = 0;
+      if (*temporal_tracking_)
+      {
+        use_hull_cache_ = previous_holes_ && previous_finite_mask_.width () == finite_mask_.width () &&
+          previous_finite_mask_.height () == finite_mask_.height () &&
+          similarPlanes (cache_model_, model_coefficients_->values, *plane_dist_threshold_);
+        if (use_hull_cache_)
         {
-          if (pointInPolygon2D (hull_2Dcoords, *hole_it))
-          {
-            inside++;
-          }
-          else
-          {
-            outside++;
-          }
-          hole_it++;
+          nr_changed_tiles_ = diffImageBufferTiles (finite_mask_, previous_finite_mask_,
+              TEMPORAL_TILE_SIZE, changed_mask_tiles_);
+          nr_changed_tiles_ += diffImageBufferTiles (table_mask_, previous_table_mask_,
+              TEMPORAL_TILE_SIZE, changed_table_tiles_);
+          table_hull_unchanged_ = (*hull_indices_)->indices == previous_hull_indices_;
         }
-        // TODO: probably some fraction dependent on min_hole_size_ should be used
-        if (outside > 0)
+        else
         {
-          if (outside > inside * (*inside_out_factor_))
-          {
-            // TODO: could we use these later somewhere or can they be safely discarded?
-            outside_holes.push_back (*all_holes_it);
-            outside_borders.push_back (*all_borders_it);
-          }
-          else
-          {
-            overlap_holes.push_back (*all_holes_it);
-            overlap_borders.push_back (*all_borders_it);
-          }
+          hull_cache_.clear ();
+          cache_model_ = model_coefficients_->values;
         }
-        else
+        previous_table_mask_ = table_mask_;
+        previous_hull_indices_ = (*hull_indices_)->indices;
+
+        // nothing changed at all, thus the holes of the previous frame are still valid
+        if (use_hull_cache_ && nr_changed_tiles_ == 0 && table_hull_unchanged_)
         {
-          inside_holes.push_back (*all_holes_it);
-          inside_borders.push_back (*all_borders_it);
+          ROS_DEBUG_STREAM_NAMED ("HoleDetector", "NaN mask and table hull unchanged, reusing the "
+              << previous_holes_->convex_hulls.size () << " holes of the previous frame");
+          auto holes_msg = boost::make_shared<transparent_object_reconstruction::Holes> (*previous_holes_);
+          for (size_t i = 0; i < holes_msg->convex_hulls.size (); ++i)
+          {
+            holes_msg->convex_hulls[i].header = pcl_conversions::fromPCL (input->header);
+          }
+          auto compact_holes = boost::make_shared<transparent_object_reconstruction::CompactHoles> (*previous_compact_holes_);
+          compact_holes->header = pcl_conversions::fromPCL (input->header);
+          *remove_indices_ = previous_remove_indices_;
+          *holes_mgs_ = holes_msg;
+          *compact_holes_ = compact_holes;
+          previous_holes_ = holes_msg;
+          previous_compact_holes_ = compact_holes;
+          return;
         }
-        all_holes_it++;
-        all_borders_it++;
       }
+      else
+      {
+        previous_holes_.reset ();
+        previous_compact_holes_.reset ();
+        hull_cache_.clear ();
+      }
+
+      collectFrameRegions (finite_mask_, table_mask_, table_spans_, nan_regions_);
+      buildHoles (input, *temporal_tracking_);
+    }
+
+  /* Computes the hulls of the labeled NaN regions of the current frame state (finite mask,
+   * table mask, NaN regions, table hull coordinates and model), fuses them and sets the
+   * outputs 'holes', 'compact_holes' and 'remove_indices'. With 'temporal' the hulls of
+   * unchanged regions are taken from the cache.
+   */
+  template <typename PointT>
+    void buildHoles (boost::shared_ptr<const ::pcl::PointCloud<PointT> > &input, bool temporal)
+    {
+      size_t nr_reused_regions = 0;
+
+      // the removal mask is all zero outside of process
+      remove_mask_.resize (input->width, input->height, 0);
+      remove_min_ = Eigen::Vector2i (input->width, input->height);
+      remove_max_ = Eigen::Vector2i (-1, -1);
+
+      // retrieve the 3D coordinates of the convex hull of the tabletop
+      if (prepare_points_)
+      {
+        prepare_points_ (table_hull_coords_.data (), table_hull_coords_.data () + table_hull_coords_.size ());
+      }
+      auto table_convex_hull = boost::make_shared<::pcl::PointCloud<PointT> > ();
+      table_convex_hull->points.reserve (table_hull_coords_.size ());
+      std::vector<Eigen::Vector2i>::const_iterator hull_coord_it = table_hull_coords_.begin ();
+      while (hull_coord_it != table_hull_coords_.end ())
+      {
+        table_convex_hull->points.push_back (input->at ((*hull_coord_it)[0], (*hull_coord_it)[1]));
+        hull_coord_it++;
+      }
+      table_convex_hull->width = table_convex_hull->points.size ();
+      table_convex_hull->height = 1;
+
+      // collected all nan-regions that contain at least 1 nan-pixel inside the convex hull of the table
+      size_t nr_inside = std::count (nan_regions_.classes.begin (), nan_regions_.classes.end (), REGION_INSIDE);
+      size_t nr_overlap = std::count (nan_regions_.classes.begin (), nan_regions_.classes.end (), REGION_OVERLAP);
+      ROS_DEBUG_STREAM_NAMED ("HoleDetector", "NaN region labeling resulted in " << nan_regions_.size ()
+          << " regions, " << nr_inside << " inside and " << nr_overlap << " overlapping the table hull");
 
       std::vector<boost::shared_ptr<::pcl::PointCloud<PointT> > > remaining_hulls;
       std::vector<std::vector<Eigen::Vector2i> > remaining_hull_coords;
-      remaining_hulls.reserve (inside_borders.size () + overlap_borders.size ());
-      remaining_hull_coords.reserve (inside_borders.size () + overlap_borders.size ());
+      remaining_hulls.reserve (nr_inside + nr_overlap);
+      remaining_hull_coords.reserve (nr_inside + nr_overlap);
 
       // create array to store all non nan-points that are enclosed by the hole
       // and should be removed before clustering
       ::pcl::PointIndices::Ptr remove_indices (new ::pcl::PointIndices);
       std::vector<Eigen::Vector2i>::const_iterator coord_it;
 
-      Eigen::Vector4f plane_coefficients ((*model_)->values[0], (*model_)->values[1],
-          (*model_)->values[2], (*model_)->values[3]);
+      Eigen::Vector4f plane_coefficients (model_coefficients_->values[0], model_coefficients_->values[1],
+          model_coefficients_->values[2], model_coefficients_->values[3]);
 
       // create representations for the holes completely inside convex hull of table top
       auto holes_msg= boost::make_shared<transparent_object_reconstruction::Holes>();
-      holes_msg->convex_hulls.reserve (inside_holes.size ());
-      for (size_t i = 0; i < inside_borders.size (); ++i)
-      {
-        auto border_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
-        erodeBorder (input, inside_borders[i], border_cloud, 2);
-
-        double dist_sum = .0f;
-        auto border_it = border_cloud->points.begin ();
-
-        // TODO: only compute the average distance from border points to idealized table plane
-        // for those points that belong to the outside border and not to potentially spurious
-        // measurement points that are enclosed by the convex hull; implement fix for this!
-//        // check if hole border aligns with tabletop (or hole was caused by noise of tabletop obj)
-//        while (border_it != border_cloud->points.end ())
-//        {
-//          dist_sum += ::pcl::pointToPlaneDistance (*border_it++, plane_coefficients);
-//        }
-//
-//        double avg_dist = dist_sum / static_cast<double> (border_cloud->points.size ());
-//        if (avg_dist > *plane_dist_threshold_)
-//        {
-//          // skip hole! should something more be done?
-//          // TODO: remove measurement points inside hole anyway?
-//          continue;
-//        }
-
-        // project border into plane and retrieve convex hull
-        auto conv_border_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
-        ::pcl::PointIndices conv_border_indices;
-        projectBorderAndCreateHull (border_cloud, conv_border_cloud, conv_border_indices);
-
-        std::vector<Eigen::Vector2i> convex_hull_polygon;
-        convex_hull_polygon.reserve (conv_border_indices.indices.size ());
-        std::vector<int>::const_iterator hull_it = conv_border_indices.indices.begin ();
-        while (hull_it != conv_border_indices.indices.end ())
-        {
-          convex_hull_polygon.push_back (inside_borders[i][*hull_it++]);
-        }
-        // store indices of points that are inside the convex hull - these will be removed later
-        bool touches_border;
-        Eigen::Vector2i min_bbox, max_bbox;
-        // check if hole touches border
-        get2DHullBBox (input, convex_hull_polygon, min_bbox, max_bbox, touches_border);
-        if (!touches_border)
-        {
-          remaining_hulls.push_back (conv_border_cloud);
-          remaining_hull_coords.push_back (convex_hull_polygon);
-
-        }
-        // else discard the hole
+      holes_msg->convex_hulls.reserve (nr_inside);
+      auto compact_holes = boost::make_shared<transparent_object_reconstruction::CompactHoles> ();
+      compact_holes->header = pcl_conversions::fromPCL (input->header);
+      for (size_t i = 0; i < 4; ++i)
+      {
+        compact_holes->plane_coefficients[i] = plane_coefficients[i];
       }
-
-      // work on the holes that are partially inside the convex hull
-      for (size_t i = 0; i < overlap_borders.size (); ++i)
+      // compute the hulls of the inside regions first, then the ones of the overlapping regions
+      const RegionClass hull_classes[] = {REGION_INSIDE, REGION_OVERLAP};
+      for (size_t c = 0; c < 2; ++c)
       {
-        // first retrieve the 3D points from the extracted border, project into plane and distinguish which are inside the table convex hull
-        auto extracted_border_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
-        auto inside_hull_border = boost::make_shared<::pcl::PointCloud<PointT> > ();
-        extracted_border_cloud->points.reserve (overlap_borders[i].size ());
-        inside_hull_border->points.reserve (overlap_borders[i].size ());
-        PointT projection;
-        double dist_sum = 0.0f;
-        std::vector<Eigen::Vector2i>::const_iterator coord_it = overlap_borders[i].begin ();
-        while (coord_it != overlap_borders[i].end ())
+        for (size_t r = 0; r < nan_regions_.size (); ++r)
         {
-          if (projectPointOnPlane<PointT> (input->at ((*coord_it)[0], (*coord_it)[1]), projection, plane_coefficients))
+          if (nan_regions_.classes[r] != hull_classes[c])
+            continue;
+
+          // in the temporal mode the hull of an unchanged region is taken from the previous frame
+          const Eigen::Vector2i &first_pixel = *nan_regions_.holeBegin (r);
+          int region_key = first_pixel[1] * input->width + first_pixel[0];
+          if (temporal)
           {
-            extracted_border_cloud->points.push_back (projection);
-            if (pointInPolygon2D (hull_2Dcoords, *coord_it))
+            std::map<int, CachedRegionHull>::iterator cache_it = hull_cache_.find (region_key);
+            if (use_hull_cache_ && cache_it != hull_cache_.end () &&
+                regionUnchanged (r, cache_it->second, table_hull_unchanged_))
             {
-              dist_sum += ::pcl::pointToPlaneDistance (input->at ((*coord_it)[0], (*coord_it)[1]), plane_coefficients);
-              inside_hull_border->points.push_back (projection);
+              if (cache_it->second.has_hull)
+              {
+                auto cached_hull = boost::make_shared<::pcl::PointCloud<PointT> > ();
+                ::pcl::fromPCLPointCloud2 (cache_it->second.hull_cloud, *cached_hull);
+                remaining_hulls.push_back (cached_hull);
+                remaining_hull_coords.push_back (cache_it->second.hull_coords);
+              }
+              next_hull_cache_[region_key] = cache_it->second;
+              nr_reused_regions++;
+              continue;
             }
           }
-          // otherwise discard the point
-          coord_it++;
-        }
-        // set dimension
-        extracted_border_cloud->width = extracted_border_cloud->points.size ();
-        extracted_border_cloud->height = 1;
-        inside_hull_border->width = inside_hull_border->points.size ();
-        inside_hull_border->height = 1;
 
-        double avg_dist = dist_sum / static_cast<double> (inside_hull_border->points.size ());
-        if (avg_dist > *plane_dist_threshold_ * 3.0f) // TODO: perhaps remove the points with the largest 3 distances instead?
-        {
-          //skip hole! should something more be done?
-          continue;
-        }
-
-        unsigned int inside_points = 0;
-        // create a marker to check which of the border points are inside the convex hull
-        std::vector<bool> point_inside (overlap_borders[i].size (), false);
-
-        coord_it = overlap_borders[i].begin ();
-        if (extracted_border_cloud->points.size () > 0 &&
-            minDistAboveThreshold (table_convex_hull, inside_hull_border, *min_distance_to_convex_hull_))
-        {
-          // erode border cloud
-          auto border_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
-          erodeBorder (input, overlap_borders[i], border_cloud, 2);
-
-          // project border into plane and retrieve convex hull
-          ::pcl::PointIndices conv_border_indices;
-          auto conv_proj_border_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
-          projectBorderAndCreateHull (border_cloud, conv_proj_border_cloud, conv_border_indices);
-
-          std::vector<Eigen::Vector2i> convex_hull_polygon;
-          convex_hull_polygon.reserve (conv_border_indices.indices.size ());
-          std::vector<int>::const_iterator hull_it = conv_border_indices.indices.begin ();
-          while (hull_it != conv_border_indices.indices.end ())
+          auto hull_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
+          std::vector<Eigen::Vector2i> hull_coords;
+          bool has_hull = computeRegionHull (input, r, table_convex_hull, plane_coefficients,
+              hull_cloud, hull_coords);
+          if (has_hull)
           {
-            convex_hull_polygon.push_back (overlap_borders[i][*hull_it++]);
+            remaining_hulls.push_back (hull_cloud);
+            remaining_hull_coords.push_back (hull_coords);
           }
-          // store indices of points that are inside the convex hull - these will be removed later
-          bool touches_border;
-          Eigen::Vector2i min_bbox, max_bbox;
-          // check if hole touches border
-          get2DHullBBox (input, convex_hull_polygon, min_bbox, max_bbox, touches_border);
-          if (!touches_border)
+          if (temporal)
           {
-            remaining_hulls.push_back (conv_proj_border_cloud);
-            remaining_hull_coords.push_back (convex_hull_polygon);
+            CachedRegionHull &entry = next_hull_cache_[region_key];
+            entry.nr_hole_pixels = nan_regions_.nrHolePixels (r);
+            entry.nr_border_pixels = nan_regions_.nrBorderPixels (r);
+            entry.region_class = nan_regions_.classes[r];
+            entry.has_hull = has_hull;
+            if (has_hull)
+            {
+              ::pcl::toPCLPointCloud2 (*hull_cloud, entry.hull_cloud);
+              entry.hull_coords.swap (hull_coords);
+            }
           }
-          // else discard the hole
         }
       }
+      if (temporal)
+      {
+        hull_cache_.swap (next_hull_cache_);
+        next_hull_cache_.clear ();
+        ROS_DEBUG_STREAM_NAMED ("HoleDetector", "Reused the hulls of " << nr_reused_regions << " of "
+            << nr_inside + nr_overlap << " NaN regions (" << nr_changed_tiles_ << " changed tiles)");
+      }
 
       // check if some the remaining holes should be merged depending on their distance
       std::vector<boost::shared_ptr<::pcl::PointCloud<PointT> > > fused_hull_clouds;
@@ -1149,13 +1894,9 @@ struct HoleDetector
         auto hull_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
         hull_cloud->header = fused_hull_clouds[i]->header;
 
-        // now do a convex hull computation
+        // now do a convex hull computation (all hull points are already projected into the plane)
         ::pcl::PointIndices convex_hull_indices;
-        ::pcl::ConvexHull<PointT> c_hull;
-        c_hull.setInputCloud (fused_hull_clouds[i]);
-        c_hull.setDimension (2);
-        c_hull.reconstruct (*hull_cloud);
-        c_hull.getHullPointIndices (convex_hull_indices);
+        createPlaneConvexHull (fused_hull_clouds[i], hull_cloud, convex_hull_indices);
 
         // retrieve the 2D coordinates for the resulting hull
         std::vector<int>::const_iterator c_index_it = convex_hull_indices.indices.begin ();
@@ -1168,66 +1909,298 @@ struct HoleDetector
 
         // check if there are measurement points inside the current hull that should be removed
         bool touches_border;
-        addRemoveIndices (input, current_hull_coords, remove_indices, touches_border);
+        markRemovePixels (input, finite_mask_, current_hull_coords, touches_border);
 
         // add to hole msgs
         hull_cloud->header = input->header;
         sensor_msgs::PointCloud2 pc2;
         pcl::toROSMsg (*hull_cloud, pc2);
         holes_msg->convex_hulls.push_back (pc2);
+        addHullToCompactHoles (*hull_cloud, *compact_holes);
       }
 
-      if (remove_indices->indices.size () > 1)
+      // collect the indices of all marked points in a single ordered scan (thus they are sorted
+      // and unique) and reset the removal mask for the next frame
+      if (remove_min_[0] <= remove_max_[0])
       {
-        // depending on what we want to do later it might be more convenient, if the remove indices are ordered
-        ::std::sort (remove_indices->indices.begin (), remove_indices->indices.end ());
-        // copy indices into output (and make sure that no index is inserted more than once
-        ::pcl::PointIndices::Ptr tmp_indices (new ::pcl::PointIndices);
-        tmp_indices->indices.reserve (remove_indices->indices.size ());
-        std::vector<int>::const_iterator index_it = remove_indices->indices.begin ();
-        tmp_indices->indices.push_back (*index_it++);
-        while (index_it != remove_indices->indices.end ())
+        for (int v = remove_min_[1]; v <= remove_max_[1]; ++v)
         {
-          if (*index_it != tmp_indices->indices.back ())
+          char *remove_row = &remove_mask_ (0, v);
+          for (int u = remove_min_[0]; u <= remove_max_[0]; ++u)
           {
-            tmp_indices->indices.push_back (*index_it);
+            if (remove_row[u])
+            {
+              remove_indices->indices.push_back (v * input->width + u);
+              remove_row[u] = 0;
+            }
           }
-          index_it++;
         }
-        *remove_indices_ = tmp_indices;
       }
-      else
+      *remove_indices_ = remove_indices;
+      *holes_mgs_ = holes_msg;
+      *compact_holes_ = compact_holes;
+      if (temporal)
       {
-        *remove_indices_ = remove_indices;
+        previous_holes_ = holes_msg;
+        previous_compact_holes_ = compact_holes;
+        previous_remove_indices_ = remove_indices;
       }
-
-      // TODO: do we still need the filtered point cloud as output?
-      // set all points in the point cloud to nan, if their index was contained in remove_indices
-      typename ::pcl::ExtractIndices<PointT> extractor;
-      auto filtered_cloud = boost::make_shared<::pcl::PointCloud<PointT> > ();
-      extractor.setKeepOrganized (true);
-      extractor.setNegative (true);
-      extractor.setInputCloud (input);
-      extractor.setIndices (remove_indices);
-      extractor.filter (*filtered_cloud);
-
-      *output_ = ecto::pcl::xyz_cloud_variant_t (filtered_cloud);
-      *holes_mgs_ = holes_msg;
-
-      return ecto::OK;
     }
 
   ecto::spore<size_t> min_hole_size_;
   ecto::spore<float> inside_out_factor_;
   ecto::spore<float> plane_dist_threshold_;
   ecto::spore<float> min_distance_to_convex_hull_;
+  ecto::spore<bool> nan_mark_output_;
+  ecto::spore<size_t> pyramid_level_;
+  ecto::spore<int> labeling_tile_size_;
+  ecto::spore<size_t> labeling_threads_;
+  ecto::spore<bool> pipelined_;
+  ecto::spore<bool> temporal_tracking_;
+  ecto::spore<std::string> table_frame_;
+  ecto::spore<std::string> map_frame_;
   ecto::spore<::pcl::PointIndices::ConstPtr> hull_indices_;
   ecto::spore<::pcl::ModelCoefficients::ConstPtr> model_;
   ecto::spore<ecto::pcl::PointCloud> output_;
   ecto::spore<transparent_object_reconstruction::Holes::ConstPtr> holes_mgs_;
+  ecto::spore<transparent_object_reconstruction::CompactHoles::ConstPtr> compact_holes_;
   ecto::spore<::pcl::PointIndices::ConstPtr> remove_indices_;
+
+  ImageBuffer<char> finite_mask_;
+  ImageBuffer<char> dilation_mask_;
+  std::vector<Eigen::Vector2i> eroded_border_coords_;
+  std::vector<Eigen::Vector2f> hull_plane_coords_;
+  std::vector<int> hull_sort_buffer_;
+  ImageBuffer<char> table_mask_;
+  std::vector<Eigen::Vector3i> table_spans_;
+  std::vector<Eigen::Vector2i> table_hull_coords_;
+  ::pcl::ModelCoefficients::ConstPtr model_coefficients_;  // model of the frame whose holes are built
+  ImageBuffer<char> remove_mask_;
+  Eigen::Vector2i remove_min_;
+  Eigen::Vector2i remove_max_;
+  NaNLabelingBuffers labeling_buffers_;
+  NaNRegions nan_regions_;
+  // workers for the labeling of the tiles
+  boost::shared_ptr<ThreadPool> thread_pool_;
+  // state of the temporal mode
+  ImageBuffer<char> previous_finite_mask_;
+  ImageBuffer<char> previous_table_mask_;
+  ImageBuffer<char> changed_mask_tiles_;
+  ImageBuffer<char> changed_table_tiles_;
+  std::vector<int> previous_hull_indices_;
+  std::vector<float> cache_model_;  // model of the frame the hull cache was started in
+  std::map<int, CachedRegionHull> hull_cache_;
+  std::map<int, CachedRegionHull> next_hull_cache_;
+  bool use_hull_cache_;
+  bool table_hull_unchanged_;
+  size_t nr_changed_tiles_;
+  transparent_object_reconstruction::Holes::ConstPtr previous_holes_;
+  transparent_object_reconstruction::CompactHoles::ConstPtr previous_compact_holes_;
+  ::pcl::PointIndices::ConstPtr previous_remove_indices_;
+  // state of the pipelined mode
+  ecto::pcl::xyz_cloud_variant_t labeled_input_;
+  FrameState pending_frame_;
+  // embedding of the transforms into the compact holes
+  boost::shared_ptr<tf::TransformListener> tf_listener_;
+  // called with the pixels whose points are read next (the input is only sparsely valid)
+  boost::function<void (const Eigen::Vector2i*, const Eigen::Vector2i*)> prepare_points_;
+};
+
+/* Variant of HoleDetector that works directly on a depth image (16UC1 in millimeters or
+ * 32FC1 in meters, invalid measurements are 0 or NaN) and the intrinsics of the camera.
+ * The NaN regions, their borders and the table hull tests only use the finite mask of
+ * the depth image. 3D points are back-projected only for the pixels that are read by
+ * the hull computation; they are written into a cloud that is kept across frames and
+ * is invalid at all other pixels.
+ */
+struct DepthHoleDetector : HoleDetector
+{
+  static void declare_params (tendrils& params)
+  {
+    HoleDetector::declare_params (params);
+  }
+
+  static void declare_io ( const tendrils& params, tendrils& inputs, tendrils& outputs)
+  {
+    inputs.declare<sensor_msgs::ImageConstPtr> ("image", "Depth image (16UC1 in mm or 32FC1 in m).");
+    inputs.declare<sensor_msgs::CameraInfoConstPtr> ("camera_info", "Camera info of the depth image.");
+    inputs.declare<::pcl::PointIndices::ConstPtr> ("hull_indices", "The indices describing the convex hull to the table surface.");
+    inputs.declare<::pcl::ModelCoefficients::ConstPtr> ("model", "Model coefficients for the planar table surface.");
+    outputs.declare<sensor_msgs::ImageConstPtr> ("output", "Depth image with the measurements inside the detected holes invalidated.");
+    outputs.declare<transparent_object_reconstruction::Holes::ConstPtr> ("holes", "Detected holes inside the table convex hull.");
+    outputs.declare<transparent_object_reconstruction::CompactHoles::ConstPtr> ("compact_holes", "Detected holes inside the table convex hull, packed into a single vertex array.");
+    outputs.declare<::pcl::PointIndices::ConstPtr> ("remove_indices", "Indices of points inside the detected holes.");
+  }
+
+  void configure( const tendrils& params, const tendrils& inputs, const tendrils& outputs)
+  {
+    configureDetection (params, inputs, outputs);
+    image_ = inputs["image"];
+    camera_info_ = inputs["camera_info"];
+    depth_output_ = outputs["output"];
+    depth_cloud_ = boost::make_shared<::pcl::PointCloud<::pcl::PointXYZ> > ();
+    prepare_points_ = [this] (const Eigen::Vector2i *begin, const Eigen::Vector2i *end)
+    {
+      backProjectPixels (begin, end);
+    };
+  }
+
+  int process( const tendrils& inputs, const tendrils& outputs)
+  {
+    if (*pipelined_)
+    {
+      ROS_WARN_ONCE_NAMED ("HoleDetector", "pipelined is not supported by DepthHoleDetector and ignored");
+    }
+    const sensor_msgs::Image &image = **image_;
+    const sensor_msgs::CameraInfo &camera_info = **camera_info_;
+    if (image.encoding != sensor_msgs::image_encodings::TYPE_16UC1 &&
+        image.encoding != sensor_msgs::image_encodings::TYPE_32FC1)
+    {
+      throw std::runtime_error ("DepthHoleDetector: unsupported depth image encoding " + image.encoding);
+    }
+    if (camera_info.K[0] == 0.0 || camera_info.K[4] == 0.0)
+    {
+      throw std::runtime_error ("DepthHoleDetector: camera info without intrinsics");
+    }
+    float_depth_ = image.encoding == sensor_msgs::image_encodings::TYPE_32FC1;
+    inv_fx_ = 1.0f / camera_info.K[0];
+    inv_fy_ = 1.0f / camera_info.K[4];
+    cx_ = camera_info.K[2];
+    cy_ = camera_info.K[5];
+
+    // the temporal mode keeps the mask of the previous frame
+    if (*temporal_tracking_)
+    {
+      finite_mask_.swap (previous_finite_mask_);
+    }
+    computeDepthFiniteMask (image);
+
+    // the points of the cloud are only back-projected on demand
+    if (depth_cloud_->width != image.width || depth_cloud_->height != image.height)
+    {
+      depth_cloud_->points.resize (image.width * image.height);
+      depth_cloud_->width = image.width;
+      depth_cloud_->height = image.height;
+      depth_cloud_->is_dense = false;
+    }
+    pcl_conversions::toPCL (image.header, depth_cloud_->header);
+    boost::shared_ptr<const ::pcl::PointCloud<::pcl::PointXYZ> > input = depth_cloud_;
+
+    detectHoles (input);
+
+    // invalidate the removed measurements in a copy of the image (if there are any)
+    const std::vector<int> &indices = (*remove_indices_)->indices;
+    if (indices.empty ())
+    {
+      *depth_output_ = *image_;
+    }
+    else
+    {
+      auto output_image = boost::make_shared<sensor_msgs::Image> (image);
+      std::vector<int>::const_iterator index_it = indices.begin ();
+      while (index_it != indices.end ())
+      {
+        const int u = *index_it % image.width;
+        const int v = *index_it / image.width;
+        uint8_t *row = &output_image->data[v * image.step];
+        if (float_depth_)
+        {
+          float invalid = std::numeric_limits<float>::quiet_NaN ();
+          memcpy (row + u * sizeof (float), &invalid, sizeof (float));
+        }
+        else
+        {
+          memset (row + u * sizeof (uint16_t), 0, sizeof (uint16_t));
+        }
+        index_it++;
+      }
+      *depth_output_ = output_image;
+    }
+    embedTransforms ();
+
+    return ecto::OK;
+  }
+
+  /* Returns the depth in meters at the given pixel (NaN for invalid measurements). */
+  float depthInMeters (const sensor_msgs::Image &image, int u, int v) const
+  {
+    const uint8_t *data = &image.data[v * image.step];
+    if (float_depth_)
+    {
+      float depth;
+      memcpy (&depth, data + u * sizeof (float), sizeof (float));
+      return depth > 0.0f ? depth : std::numeric_limits<float>::quiet_NaN ();
+    }
+    uint16_t depth;
+    memcpy (&depth, data + u * sizeof (uint16_t), sizeof (uint16_t));
+    return depth != 0 ? depth * 0.001f : std::numeric_limits<float>::quiet_NaN ();
+  }
+
+  /* Sets the finite mask from the depth image: a measurement is valid if it is
+   * positive (and not NaN or infinite for float images).
+   */
+  void computeDepthFiniteMask (const sensor_msgs::Image &image)
+  {
+    finite_mask_.resize (image.width, image.height);
+    for (int v = 0; v < static_cast<int> (image.height); ++v)
+    {
+      const uint8_t *data = &image.data[v * image.step];
+      char *mask_row = &finite_mask_ (0, v);
+      if (float_depth_)
+      {
+        const uint32_t exponent_bits = 0x7f800000;
+        for (int u = 0; u < static_cast<int> (image.width); ++u)
+        {
+          float depth;
+          uint32_t bits;
+          memcpy (&depth, data + u * sizeof (float), sizeof (float));
+          memcpy (&bits, &depth, sizeof (uint32_t));
+          mask_row[u] = ((bits & exponent_bits) != exponent_bits) & (depth > 0.0f);
+        }
+      }
+      else
+      {
+        for (int u = 0; u < static_cast<int> (image.width); ++u)
+        {
+          uint16_t depth;
+          memcpy (&depth, data + u * sizeof (uint16_t), sizeof (uint16_t));
+          mask_row[u] = depth != 0;
+        }
+      }
+    }
+  }
+
+  /* Back-projects the given pixels of the current depth image into 'depth_cloud_'. */
+  void backProjectPixels (const Eigen::Vector2i *begin, const Eigen::Vector2i *end)
+  {
+    const sensor_msgs::Image &image = **image_;
+    while (begin != end)
+    {
+      const int u = (*begin)[0];
+      const int v = (*begin)[1];
+      ::pcl::PointXYZ &p = depth_cloud_->points[v * image.width + u];
+      p.z = depthInMeters (image, u, v);
+      p.x = (u - cx_) * p.z * inv_fx_;
+      p.y = (v - cy_) * p.z * inv_fy_;
+      begin++;
+    }
+  }
+
+  ecto::spore<sensor_msgs::ImageConstPtr> image_;
+  ecto::spore<sensor_msgs::CameraInfoConstPtr> camera_info_;
+  ecto::spore<sensor_msgs::ImageConstPtr> depth_output_;
+
+  boost::shared_ptr<::pcl::PointCloud<::pcl::PointXYZ> > depth_cloud_;
+  bool float_depth_;
+  float inv_fx_;
+  float inv_fy_;
+  float cx_;
+  float cy_;
 };
 
 ECTO_CELL(hole_detection, ecto::pcl::PclCell<HoleDetector>,
     "HoleDetector", "Extract a new cloud given an existing cloud and a set of indices to extract.");
 
+ECTO_CELL(hole_detection, DepthHoleDetector,
+    "DepthHoleDetector", "Detect holes in the table top directly on a depth image and the camera intrinsics.");
+
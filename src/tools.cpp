@@ -1604,6 +1604,102 @@ pointInPolygon2D (const std::vector<Eigen::Vector2i> &polygon, const Eigen::Vect
   return inside;
 }
 
+void
+polygonScanlineSpans2D (const std::vector<Eigen::Vector2i> &polygon, std::vector<Eigen::Vector3i> &spans)
+{
+  spans.clear ();
+  if (polygon.size () == 0)
+  {
+    return;
+  }
+
+  // only rows in (min_y, max_y] can be crossed by an edge
+  int min_y = polygon.front ()[1];
+  int max_y = polygon.front ()[1];
+  std::vector<Eigen::Vector2i>::const_iterator p_it = polygon.begin ();
+  while (p_it != polygon.end ())
+  {
+    min_y = std::min (min_y, (*p_it)[1]);
+    max_y = std::max (max_y, (*p_it)[1]);
+    p_it++;
+  }
+  const int nr_rows = max_y - min_y;
+  if (nr_rows == 0)
+  {
+    return;
+  }
+
+  // count the crossing edges per row and compute the offsets of each row's crossings
+  std::vector<int> row_offsets (nr_rows + 1, 0);
+  size_t start = polygon.size () - 1;  // last vertex
+  for (size_t end = 0; end < polygon.size (); start = end++)
+  {
+    int lower = std::min (polygon[start][1], polygon[end][1]);
+    int upper = std::max (polygon[start][1], polygon[end][1]);
+    for (int y = lower + 1; y <= upper; ++y)
+    {
+      row_offsets[y - min_y]++;
+    }
+  }
+  for (int r = 0; r < nr_rows; ++r)
+  {
+    row_offsets[r + 1] += row_offsets[r];
+  }
+
+  // An edge (s, e) that crosses row y toggles the 'inside' state of 'pointInPolygon2D ()'
+  // for all columns x <= T; with dy = e_y - s_y and K = dy * e_x - (e_y - y) * (e_x - s_x):
+  // T = floor (K / dy) for dy > 0 and T = ceil (K / dy) - 1 for dy < 0
+  std::vector<int> toggles (row_offsets[nr_rows]);
+  std::vector<int> fill (row_offsets.begin (), row_offsets.end () - 1);
+  start = polygon.size () - 1;
+  for (size_t end = 0; end < polygon.size (); start = end++)
+  {
+    const Eigen::Vector2i &s = polygon[start];
+    const Eigen::Vector2i &e = polygon[end];
+    int64_t dy = e[1] - s[1];
+    if (dy == 0)
+    {
+      continue;
+    }
+    int lower = std::min (s[1], e[1]);
+    int upper = std::max (s[1], e[1]);
+    for (int y = lower + 1; y <= upper; ++y)
+    {
+      int64_t k = dy * e[0] - static_cast<int64_t> (e[1] - y) * (e[0] - s[0]);
+      int64_t t;
+      if (dy > 0)
+      {
+        t = k / dy;
+        if (t * dy > k)   // round towards negative infinity
+          t--;
+      }
+      else
+      {
+        t = k / dy;
+        if (t * dy > k)   // round towards positive infinity (dy < 0)
+          t++;
+        t--;
+      }
+      toggles[fill[y - min_y - 1]++] = static_cast<int> (t);
+    }
+  }
+
+  // the number of crossings per row is even; cells in (T_1, T_2], (T_3, T_4], ... are inside
+  for (int r = 0; r < nr_rows; ++r)
+  {
+    std::vector<int>::iterator row_begin = toggles.begin () + row_offsets[r];
+    std::vector<int>::iterator row_end = toggles.begin () + row_offsets[r + 1];
+    std::sort (row_begin, row_end);
+    for (std::vector<int>::iterator t_it = row_begin; t_it + 1 < row_end; t_it += 2)
+    {
+      if (*t_it < *(t_it + 1))
+      {
+        spans.push_back (Eigen::Vector3i (min_y + 1 + r, *t_it + 1, *(t_it + 1)));
+      }
+    }
+  }
+}
+
 void
 createSampleRays (const LabelCloud::ConstPtr &base_cloud, LabelCloudPtr &ray_cloud,
     float sample_dist, Eigen::Vector3f origin)
@@ -1658,6 +1754,98 @@ createSampleRays (const LabelCloud::ConstPtr &base_cloud, LabelCloudPtr &ray_clo
   ray_cloud->height = 1;
 }
 
+/* Packs a voxel key into a single integer, the key is given relative to 'ref_key' (21 bits
+ * per axis, which covers offsets of up to 2^20 voxels).
+ */
+static uint64_t
+packVoxelKey (const Eigen::Vector3i &key, const Eigen::Vector3i &ref_key)
+{
+  const int64_t offset = 1 << 20;
+  return (static_cast<uint64_t> (key[0] - ref_key[0] + offset) << 42) |
+    (static_cast<uint64_t> (key[1] - ref_key[1] + offset) << 21) |
+    static_cast<uint64_t> (key[2] - ref_key[2] + offset);
+}
+
+void
+rasterizeFrustumVoxels (const LabelCloud::ConstPtr &base_cloud, const Eigen::Vector3f &origin,
+    const Eigen::Vector3f &grid_origin, float voxel_size, std::vector<Eigen::Vector3i> &voxel_keys)
+{
+  voxel_keys.clear ();
+
+  Eigen::Vector3i end_key;
+  for (int a = 0; a < 3; ++a)
+  {
+    end_key[a] = static_cast<int> (floor ((origin[a] - grid_origin[a]) / voxel_size));
+  }
+
+  // all rays end in the voxel of the origin and neighboring rays traverse mostly the same
+  // voxels, thus each voxel is only recorded when it's visited the first time
+  std::unordered_set<uint64_t> visited;
+  visited.reserve (base_cloud->points.size () * 4);
+
+  Eigen::Vector3f start, dir;
+  Eigen::Vector3i key, step, remaining;
+  float t_max[3], t_delta[3];
+  LabelCloud::VectorType::const_iterator p_it = base_cloud->points.begin ();
+  while (p_it != base_cloud->points.end ())
+  {
+    start = Eigen::Vector3f (p_it->x, p_it->y, p_it->z);
+    dir = origin - start;
+    for (int a = 0; a < 3; ++a)
+    {
+      key[a] = static_cast<int> (floor ((start[a] - grid_origin[a]) / voxel_size));
+      remaining[a] = std::abs (end_key[a] - key[a]);
+      // parametric distance (along the segment) to the next voxel boundary and between boundaries
+      if (dir[a] > 0.0f)
+      {
+        step[a] = 1;
+        t_max[a] = (grid_origin[a] + (key[a] + 1) * voxel_size - start[a]) / dir[a];
+        t_delta[a] = voxel_size / dir[a];
+      }
+      else if (dir[a] < 0.0f)
+      {
+        step[a] = -1;
+        t_max[a] = (grid_origin[a] + key[a] * voxel_size - start[a]) / dir[a];
+        t_delta[a] = -voxel_size / dir[a];
+      }
+      else
+      {
+        step[a] = 0;
+        remaining[a] = 0;
+        t_max[a] = std::numeric_limits<float>::max ();
+        t_delta[a] = std::numeric_limits<float>::max ();
+      }
+    }
+
+    if (visited.insert (packVoxelKey (key, end_key)).second)
+    {
+      voxel_keys.push_back (key);
+    }
+    // advance along the axis whose voxel boundary is crossed next, until the voxel that
+    // contains the origin is reached (axes that already reached it are not considered,
+    // so rounding can't cause the traversal to overshoot)
+    while (remaining[0] + remaining[1] + remaining[2] > 0)
+    {
+      int axis = -1;
+      for (int a = 0; a < 3; ++a)
+      {
+        if (remaining[a] > 0 && (axis < 0 || t_max[a] < t_max[axis]))
+        {
+          axis = a;
+        }
+      }
+      key[axis] += step[axis];
+      t_max[axis] += t_delta[axis];
+      remaining[axis]--;
+      if (visited.insert (packVoxelKey (key, end_key)).second)
+      {
+        voxel_keys.push_back (key);
+      }
+    }
+    p_it++;
+  }
+}
+
 // we assume saturation and value to be 1.0f, since we want bright distinguishable colors :)
 void
 hsv2rgb (float h, float &r, float &g, float &b)
@@ -1749,137 +1937,231 @@ lineSegmentToPointDistance (const Eigen::Vector3f &segment_start, const Eigen::V
   return sqrt ((query_point - proj).dot (query_point - proj));
 }
 
-float
-convexHullsMinDistance (const std::vector<Eigen::Vector3f> &convex_hull_a,
-    std::vector<Eigen::Vector3f> &convex_hull_b)
+/* Projects two coplanar convex hulls onto 2D coordinates of their common plane. The plane
+ * normal is estimated with Newell's method; for degenerated (collinear) hulls the plane is
+ * spanned by the points themselves. Returns false if the hulls consist of a single point.
+ */
+static bool
+projectConvexHullsToCommonPlane (const std::vector<Eigen::Vector3f> &convex_hull_a,
+    const std::vector<Eigen::Vector3f> &convex_hull_b, std::vector<Eigen::Vector2f> &projected_a,
+    std::vector<Eigen::Vector2f> &projected_b)
 {
-  // TODO: remove later
-  std::string red_start = "\033[1;31m";
-  std::string red_end = "\033[0m";
-
-  // get centroids
-  Eigen::Vector3f centroid_a = getCentroid (convex_hull_a);
-  Eigen::Vector3f centroid_b = getCentroid (convex_hull_b);
-  std::vector<Eigen::Vector3f>::const_iterator hull_it;
+  const Eigen::Vector3f &origin = convex_hull_a.front ();
 
-  Eigen::Hyperplane<float, 3> hyperplane_a ((centroid_b - centroid_a).normalized (), centroid_a);
-  Eigen::Hyperplane<float, 3> hyperplane_b ((centroid_a - centroid_b).normalized (), centroid_b);
-
-  // gather relevant points for minimal distance check
-  std::vector<Eigen::Vector3f> check_set_a, check_set_b;
-  getPointsOnPositiveSideOfHyperplane (convex_hull_a, hyperplane_a, check_set_a);
-  getPointsOnPositiveSideOfHyperplane (convex_hull_b, hyperplane_b, check_set_b);
-
-  /*
-  std::cout << "check_set_b:" << std::endl;
-  for (size_t i = 0; i < check_set_b.size (); ++i)
+  // Newell normals of both polygons (the orientation of the polygons might differ)
+  Eigen::Vector3f normal_a = Eigen::Vector3f::Zero ();
+  Eigen::Vector3f normal_b = Eigen::Vector3f::Zero ();
+  for (size_t i = 0, j = convex_hull_a.size () - 1; i < convex_hull_a.size (); j = i++)
+  {
+    normal_a += (convex_hull_a[j] - origin).cross (convex_hull_a[i] - origin);
+  }
+  for (size_t i = 0, j = convex_hull_b.size () - 1; i < convex_hull_b.size (); j = i++)
   {
-    std::cout << check_set_b[i][0] << ", " << check_set_b[i][1] << ", " << check_set_b[i][2] << std::endl;
+    normal_b += (convex_hull_b[j] - origin).cross (convex_hull_b[i] - origin);
   }
-  */
-  float min_dist = std::numeric_limits<float>::max ();
+  if (normal_a.dot (normal_b) < 0.0f)
+  {
+    normal_b = -normal_b;
+  }
+  Eigen::Vector3f normal = normal_a + normal_b;
 
-  // check the distances between all points in check_set_a and the line segments constructed by check_set_b
-  // since we don't modify the order of the points in the convex hulls all valid line segments should still
-  // be retained and one (artificial) new line segment with a (larger) distance should be added that we don't
-  // need to handle explicitly
+  if (normal.squaredNorm () <= std::numeric_limits<float>::min ())
+  {
+    // collinear hulls: use the direction to the farthest point and the farthest point from that line
+    std::vector<Eigen::Vector3f> all_points (convex_hull_a);
+    all_points.insert (all_points.end (), convex_hull_b.begin (), convex_hull_b.end ());
+    Eigen::Vector3f direction = Eigen::Vector3f::Zero ();
+    for (size_t i = 0; i < all_points.size (); ++i)
+    {
+      if ((all_points[i] - origin).squaredNorm () > direction.squaredNorm ())
+        direction = all_points[i] - origin;
+    }
+    if (direction.squaredNorm () <= std::numeric_limits<float>::min ())
+      return false;
+    for (size_t i = 0; i < all_points.size (); ++i)
+    {
+      Eigen::Vector3f tmp = direction.cross (all_points[i] - origin);
+      if (tmp.squaredNorm () > normal.squaredNorm ())
+        normal = tmp;
+    }
+    if (normal.squaredNorm () <= std::numeric_limits<float>::min ())
+      normal = direction.unitOrthogonal ();
+  }
+  normal.normalize ();
+  Eigen::Vector3f axis_u = normal.unitOrthogonal ();
+  Eigen::Vector3f axis_v = normal.cross (axis_u);
 
-  hull_it = check_set_a.begin ();
-  std::vector<Eigen::Vector3f>::const_iterator segment_start_it, segment_end_it;
-  float curr_dist;
-  std::vector<Eigen::Vector3f>::const_iterator a, b, c;
+  projected_a.resize (convex_hull_a.size ());
+  for (size_t i = 0; i < convex_hull_a.size (); ++i)
+  {
+    projected_a[i] = Eigen::Vector2f ((convex_hull_a[i] - origin).dot (axis_u),
+        (convex_hull_a[i] - origin).dot (axis_v));
+  }
+  projected_b.resize (convex_hull_b.size ());
+  for (size_t i = 0; i < convex_hull_b.size (); ++i)
+  {
+    projected_b[i] = Eigen::Vector2f ((convex_hull_b[i] - origin).dot (axis_u),
+        (convex_hull_b[i] - origin).dot (axis_v));
+  }
+  return true;
+}
 
-  //std::cout << red_start << "first segement start:\n " << *segment_start_it << std::endl;
-  //std::cout << "first segement end:\n " << *segment_end_it << red_end << std::endl;
-  while (hull_it != check_set_a.end ())
+/* Returns the support point of the Minkowski difference A - B in the given direction. */
+static Eigen::Vector2f
+minkowskiDifferenceSupport (const std::vector<Eigen::Vector2f> &points_a,
+    const std::vector<Eigen::Vector2f> &points_b, const Eigen::Vector2f &direction)
+{
+  size_t max_a = 0;
+  size_t min_b = 0;
+  float max_a_dot = points_a[0].dot (direction);
+  float min_b_dot = points_b[0].dot (direction);
+  for (size_t i = 1; i < points_a.size (); ++i)
   {
-    segment_start_it = check_set_b.begin ();
-    segment_end_it = --check_set_b.end ();
-    while (segment_start_it != check_set_b.end ())
+    float tmp = points_a[i].dot (direction);
+    if (tmp > max_a_dot)
     {
-      curr_dist = lineSegmentToPointDistance (*segment_start_it, *segment_end_it, *hull_it);
-      if (curr_dist < min_dist)
-      {
-        min_dist = curr_dist;
-        a = segment_start_it;
-        b = segment_end_it;
-        c = hull_it;
-      }
-      segment_end_it = segment_start_it++;
+      max_a_dot = tmp;
+      max_a = i;
     }
-    hull_it++;
   }
-  hull_it = check_set_b.begin ();
-  while (hull_it != check_set_b.end ())
+  for (size_t i = 1; i < points_b.size (); ++i)
   {
-    segment_start_it = check_set_a.begin ();
-    segment_end_it = --check_set_a.end ();
-    while (segment_start_it != check_set_a.end ())
+    float tmp = points_b[i].dot (direction);
+    if (tmp < min_b_dot)
     {
-      curr_dist = lineSegmentToPointDistance (*segment_start_it, *segment_end_it, *hull_it);
-      if (curr_dist < min_dist)
+      min_b_dot = tmp;
+      min_b = i;
+    }
+  }
+  return points_a[max_a] - points_b[min_b];
+}
+
+/* Returns the z-component of the cross product of two 2D vectors. */
+static inline float
+cross2D (const Eigen::Vector2f &a, const Eigen::Vector2f &b)
+{
+  return a[0] * b[1] - a[1] * b[0];
+}
+
+/* Returns the point closest to the origin on the segment between the given points. */
+static Eigen::Vector2f
+closestPointOnSegmentToOrigin (const Eigen::Vector2f &start, const Eigen::Vector2f &end)
+{
+  Eigen::Vector2f segment = end - start;
+  float length2 = segment.squaredNorm ();
+  if (length2 <= std::numeric_limits<float>::min ())
+    return start;
+  float t = std::min (1.0f, std::max (0.0f, -start.dot (segment) / length2));
+  return start + t * segment;
+}
+
+/* Determines the distance between the convex hulls of two 2D point sets with the
+ * Gilbert-Johnson-Keerthi algorithm, i.e., the distance of the Minkowski difference of
+ * both sets to the origin. Each iteration requires one support point query (linear in the
+ * number of points); the number of iterations is typically very small.
+ * If 'threshold' is non-negative, the iteration stops as soon as the distance is known to
+ * be below the threshold (the returned upper bound is then smaller than 'threshold') or not
+ * below the threshold (the returned lower bound is then at least 'threshold').
+ * Overlapping hulls have distance 0.
+ */
+static float
+convexPolygonsDistance2D (const std::vector<Eigen::Vector2f> &points_a,
+    const std::vector<Eigen::Vector2f> &points_b, float threshold)
+{
+  const float relative_tolerance = 1e-6f;
+  const size_t max_iterations = points_a.size () + points_b.size () + 3;
+
+  Eigen::Vector2f simplex[3];
+  size_t simplex_size = 1;
+  simplex[0] = points_a[0] - points_b[0];
+  Eigen::Vector2f closest = simplex[0];
+
+  for (size_t iteration = 0; iteration < max_iterations; ++iteration)
+  {
+    float closest_dist2 = closest.squaredNorm ();
+    if (closest_dist2 <= std::numeric_limits<float>::min ())
+      return 0.0f;
+    float closest_dist = std::sqrt (closest_dist2);
+    // the current closest point of the simplex is an upper bound for the distance
+    if (threshold >= 0.0f && closest_dist < threshold)
+      return closest_dist;
+
+    Eigen::Vector2f support = minkowskiDifferenceSupport (points_a, points_b, -closest);
+    // the supporting line orthogonal to 'closest' yields a lower bound for the distance
+    float lower_bound = closest.dot (support) / closest_dist;
+    if (threshold >= 0.0f && lower_bound > threshold)
+      return lower_bound;
+    if (closest_dist - lower_bound <= relative_tolerance * closest_dist)
+      return closest_dist;
+
+    // add the support point and reduce the simplex to the feature closest to the origin
+    simplex[simplex_size++] = support;
+    if (simplex_size == 2)
+    {
+      closest = closestPointOnSegmentToOrigin (simplex[0], simplex[1]);
+    }
+    else
+    {
+      // origin inside the (non-degenerated) triangle?
+      float area = cross2D (simplex[1] - simplex[0], simplex[2] - simplex[0]);
+      float cross_01 = cross2D (simplex[1] - simplex[0], -simplex[0]);
+      float cross_12 = cross2D (simplex[2] - simplex[1], -simplex[1]);
+      float cross_20 = cross2D (simplex[0] - simplex[2], -simplex[2]);
+      if (std::fabs (area) > std::numeric_limits<float>::min () &&
+          ((cross_01 >= 0.0f && cross_12 >= 0.0f && cross_20 >= 0.0f) ||
+           (cross_01 <= 0.0f && cross_12 <= 0.0f && cross_20 <= 0.0f)))
+        return 0.0f;
+      // otherwise keep the closest edge
+      size_t best_edge = 0;
+      float best_dist2 = std::numeric_limits<float>::max ();
+      for (size_t i = 0; i < 3; ++i)
       {
-        min_dist = curr_dist;
-        a = segment_start_it;
-        b = segment_end_it;
-        c = hull_it;
+        Eigen::Vector2f tmp = closestPointOnSegmentToOrigin (simplex[i], simplex[(i + 1) % 3]);
+        if (tmp.squaredNorm () < best_dist2)
+        {
+          best_dist2 = tmp.squaredNorm ();
+          best_edge = i;
+          closest = tmp;
+        }
       }
-      segment_end_it = segment_start_it++;
+      Eigen::Vector2f start = simplex[best_edge];
+      Eigen::Vector2f end = simplex[(best_edge + 1) % 3];
+      simplex[0] = start;
+      simplex[1] = end;
+      simplex_size = 2;
     }
-    hull_it++;
   }
+  return closest.norm ();
+}
 
-  std::cout << red_start << "segment_start: " << (*a)[0] << ", " << (*a)[1] << ", " << (*a)[2] << std::endl;
-  std::cout << "segment_end: " << (*b)[0] << ", " << (*b)[1] << ", " << (*b)[2] << std::endl;
-  std::cout << "query_point " << (*c)[0] << ", " << (*c)[1] << ", " << (*c)[2] << red_end << std::endl;
+/* Converts the given hulls into 2D polygons and computes their distance, see
+ * 'convexPolygonsDistance2D ()'.
+ */
+static float
+convexHullsDistance (const std::vector<Eigen::Vector3f> &convex_hull_a,
+    const std::vector<Eigen::Vector3f> &convex_hull_b, float threshold)
+{
+  if (convex_hull_a.empty () || convex_hull_b.empty ())
+    return std::numeric_limits<float>::max ();
+
+  std::vector<Eigen::Vector2f> projected_a, projected_b;
+  if (!projectConvexHullsToCommonPlane (convex_hull_a, convex_hull_b, projected_a, projected_b))
+    return 0.0f;  // all points coincide
+  return convexPolygonsDistance2D (projected_a, projected_b, threshold);
+}
 
-  return min_dist;
+float
+convexHullsMinDistance (const std::vector<Eigen::Vector3f> &convex_hull_a,
+    const std::vector<Eigen::Vector3f> &convex_hull_b)
+{
+  return convexHullsDistance (convex_hull_a, convex_hull_b, -1.0f);
 }
 
 bool
 convexHullDistBelowThreshold (const std::vector<Eigen::Vector3f> &convex_hull_a,
-    std::vector<Eigen::Vector3f> &convex_hull_b, float threshold)
+    const std::vector<Eigen::Vector3f> &convex_hull_b, float threshold)
 {
-  Eigen::Vector3f centroid_a = getCentroid (convex_hull_a);
-  Eigen::Vector3f centroid_b = getCentroid (convex_hull_b);
-
-  Eigen::Hyperplane<float, 3> hyperplane_a ((centroid_b - centroid_a).normalized (), centroid_a);
-  Eigen::Hyperplane<float, 3> hyperplane_b ((centroid_a - centroid_b).normalized (), centroid_b);
-
-  // gather relevant points for minimal distance check
-  std::vector<Eigen::Vector3f> check_set_a, check_set_b;
-  getPointsOnPositiveSideOfHyperplane (convex_hull_a, hyperplane_a, check_set_a);
-  getPointsOnPositiveSideOfHyperplane (convex_hull_b, hyperplane_b, check_set_b);
-
-  // start to iterator over check_set_a
-  std::vector<Eigen::Vector3f>::const_iterator hull_it, segment_start_it, segment_end_it;
-  hull_it = check_set_a.begin ();
-  while (hull_it != check_set_a.end ())
-  {
-    segment_start_it = check_set_b.begin ();
-    segment_end_it = --check_set_b.end ();
-    while (segment_start_it != check_set_b.end ())
-    {
-      if (lineSegmentToPointDistance (*segment_start_it, *segment_end_it, *hull_it) < threshold)
-        return true;
-      segment_end_it = segment_start_it++;
-    }
-    hull_it++;
-  }
-  hull_it = check_set_b.begin ();
-  while (hull_it != check_set_b.end ())
-  {
-    segment_start_it = check_set_a.begin ();
-    segment_end_it = --check_set_a.end ();
-    while (segment_start_it != check_set_a.end ())
-    {
-      if (lineSegmentToPointDistance (*segment_start_it, *segment_end_it, *hull_it) < threshold)
-        return true;
-      segment_end_it = segment_start_it++;
-    }
-    hull_it++;
-  }
-  return false;
+  return convexHullsDistance (convex_hull_a, convex_hull_b, threshold) < threshold;
 }
 
 Eigen::Vector3f getCentroid (const std::vector<Eigen::Vector3f> &vec)
@@ -1918,36 +2200,7 @@ bool
 doConvexHulls2DIntersect (const std::vector<Eigen::Vector3f> &convex_hull_a,
     const std::vector<Eigen::Vector3f> &convex_hull_b)
 {
-  Eigen::Vector3f centroid_a = getCentroid (convex_hull_a);
-  Eigen::Vector3f centroid_b = getCentroid (convex_hull_b);
-
-  Eigen::Hyperplane<float, 3> hyperplane_a ((centroid_b - centroid_a).normalized (), centroid_a);
-  Eigen::Hyperplane<float, 3> hyperplane_b ((centroid_a - centroid_b).normalized (), centroid_b);
-
-  // gather relevant points for minimal distance check
-  std::vector<Eigen::Vector3f> check_set_a, check_set_b;
-  getPointsOnPositiveSideOfHyperplane (convex_hull_a, hyperplane_a, check_set_a);
-  getPointsOnPositiveSideOfHyperplane (convex_hull_b, hyperplane_b, check_set_b);
-
-
-  std::vector<Eigen::Vector3f>::const_iterator hull_it;
-  hull_it = check_set_a.begin ();
-  while (hull_it != check_set_a.end ())
-  {
-    if (pointInsideConvexPolygon (convex_hull_b, *hull_it++))
-    {
-      return true;
-    }
-  }
-  hull_it  = check_set_b.begin ();
-  while (hull_it != check_set_b.end ())
-  {
-    if (pointInsideConvexPolygon (convex_hull_a, *hull_it++))
-    {
-      return true;
-    }
-  }
-  return false;
+  return convexHullsDistance (convex_hull_a, convex_hull_b, 0.0f) <= 0.0f;
 }
 
 void
@@ -2082,3 +2335,318 @@ convertLabelVectorCollection2VoxelLabelCollection (const std::vector<std::vector
     convertLabelVector2VoxelLabels (vlc[i], voxel_label_collection[i]);
   }
 }
+
+void
+initViewpointMask (ViewpointMask &mask, int angle_resolution)
+{
+  mask.assign ((angle_resolution + 63) / 64, 0);
+}
+
+size_t
+countViewpointMaskLabels (const ViewpointMask &mask)
+{
+  size_t count = 0;
+  ViewpointMask::const_iterator word_it = mask.begin ();
+  while (word_it != mask.end ())
+  {
+    count += __builtin_popcountll (*word_it++);
+  }
+  return count;
+}
+
+void
+convertViewpointMask2LabelVector (const ViewpointMask &mask, std::vector<uint32_t> &labels)
+{
+  labels.clear ();
+  labels.reserve (countViewpointMaskLabels (mask));
+  for (size_t i = 0; i < mask.size (); ++i)
+  {
+    uint64_t word = mask[i];
+    while (word != 0)
+    {
+      labels.push_back (static_cast<uint32_t> (i * 64 + __builtin_ctzll (word)));
+      word &= word - 1;  // clear lowest set bit
+    }
+  }
+}
+
+// rotates the lowest 'nr_bits' bits of 'src' by 'shift' (0 < shift < nr_bits) positions
+// towards higher bit indices, i.e., bit i is moved to bit (i + shift) % nr_bits
+static void
+rotateViewpointMask (const ViewpointMask &src, int nr_bits, int shift, ViewpointMask &dst)
+{
+  const int nr_words = static_cast<int> (src.size ());
+  // left shift by 'shift' bits
+  int word_shift = shift >> 6;
+  int bit_shift = shift & 63;
+  for (int i = 0; i < nr_words; ++i)
+  {
+    uint64_t word = 0;
+    if (i - word_shift >= 0)
+      word = src[i - word_shift] << bit_shift;
+    if (bit_shift != 0 && i - word_shift - 1 >= 0)
+      word |= src[i - word_shift - 1] >> (64 - bit_shift);
+    dst[i] = word;
+  }
+  // right shift by 'nr_bits - shift' bits (bits that were rotated out at the top)
+  word_shift = (nr_bits - shift) >> 6;
+  bit_shift = (nr_bits - shift) & 63;
+  for (int i = 0; i < nr_words; ++i)
+  {
+    uint64_t word = 0;
+    if (i + word_shift < nr_words)
+      word = src[i + word_shift] >> bit_shift;
+    if (bit_shift != 0 && i + word_shift + 1 < nr_words)
+      word |= src[i + word_shift + 1] << (64 - bit_shift);
+    dst[i] |= word;
+  }
+  // clear bits above 'nr_bits'
+  if ((nr_bits & 63) != 0)
+  {
+    dst[nr_words - 1] &= (static_cast<uint64_t> (1) << (nr_bits & 63)) - 1;
+  }
+}
+
+void
+dilateViewpointMask (const ViewpointMask &mask, int angle_resolution, int opening_angle,
+    ViewpointMask &dilated)
+{
+  dilated = mask;
+  const int window = 2 * opening_angle + 1;
+  if (window >= angle_resolution)
+  {
+    // every label covers the full circle
+    if (countViewpointMaskLabels (mask) > 0)
+    {
+      dilated.assign (mask.size (), ~static_cast<uint64_t> (0));
+      if ((angle_resolution & 63) != 0)
+      {
+        dilated.back () = (static_cast<uint64_t> (1) << (angle_resolution & 63)) - 1;
+      }
+    }
+    return;
+  }
+  if (window == 1)
+  {
+    return;
+  }
+
+  static thread_local ViewpointMask tmp;
+  tmp.resize (mask.size ());
+
+  // extend each marked label l to [l, l + width - 1] by doubling the width in each step
+  int width = 1;
+  while (2 * width <= window)
+  {
+    rotateViewpointMask (dilated, angle_resolution, width, tmp);
+    for (size_t i = 0; i < dilated.size (); ++i)
+      dilated[i] |= tmp[i];
+    width *= 2;
+  }
+  // cover the remaining part of the window (overlapping with the current width)
+  if (width < window)
+  {
+    rotateViewpointMask (dilated, angle_resolution, window - width, tmp);
+    for (size_t i = 0; i < dilated.size (); ++i)
+      dilated[i] |= tmp[i];
+  }
+  // center window, i.e., shift [l, l + 2 * opening_angle] to [l - opening_angle, l + opening_angle]
+  rotateViewpointMask (dilated, angle_resolution, angle_resolution - opening_angle, tmp);
+  dilated.swap (tmp);
+}
+
+// returns the first position >= 'pos' whose bit equals 'value', or 'nr_bits' if there is none
+static int
+findNextViewpointMaskBit (const ViewpointMask &mask, int nr_bits, int pos, bool value)
+{
+  size_t word_index = pos >> 6;
+  uint64_t word = (value ? mask[word_index] : ~mask[word_index]) & (~static_cast<uint64_t> (0) << (pos & 63));
+  while (word == 0)
+  {
+    if (++word_index >= mask.size ())
+      return nr_bits;
+    word = value ? mask[word_index] : ~mask[word_index];
+  }
+  return std::min (static_cast<int> (word_index * 64 + __builtin_ctzll (word)), nr_bits);
+}
+
+void
+convertViewpointMask2VoxelViewpointIntervals (const ViewpointMask &mask, int angle_resolution,
+    transparent_object_reconstruction::VoxelViewPointIntervals &voxel_vp_intervals)
+{
+  voxel_vp_intervals.intervals.clear ();
+  transparent_object_reconstruction::ViewpointInterval vpi;
+  int lower = findNextViewpointMaskBit (mask, angle_resolution, 0, true);
+  while (lower < angle_resolution)
+  {
+    int end = findNextViewpointMaskBit (mask, angle_resolution, lower, false);
+    vpi.lower = lower;
+    vpi.upper = end - 1;
+    voxel_vp_intervals.intervals.push_back (vpi);
+    if (end >= angle_resolution)
+      break;
+    lower = findNextViewpointMaskBit (mask, angle_resolution, end, true);
+  }
+}
+
+void
+computeViewpointIntervalsICL (const std::vector<uint32_t> &labels, int angle_resolution,
+    int opening_angle, boost::icl::interval_set<int> &vp_intervals)
+{
+  vp_intervals.clear ();
+  if (labels.size () == 0)
+  {
+    return;
+  }
+
+  // generate the viewpoint intervals from the labels
+  std::vector<uint32_t>::const_iterator label_it = labels.begin ();
+  int lower_bound, upper_bound;
+  while (label_it != labels.end ())
+  {
+    // compute interval limits
+    lower_bound = static_cast<int> (*label_it) - opening_angle;
+    upper_bound = static_cast<int> (*label_it) + opening_angle;
+    // add one interval (negative lower bound or upper bound larger than angle_resolution are allowed)
+    vp_intervals.insert (boost::icl::construct<boost::icl::discrete_interval<int> >
+        (lower_bound, upper_bound, boost::icl::interval_bounds::closed ()));
+    label_it++;
+  }
+
+  // check if intervals in set need to be normalized
+  if (vp_intervals.begin ()->lower () < 0)
+  {
+    lower_bound = vp_intervals.begin ()->lower ();
+    upper_bound = vp_intervals.begin ()->upper ();
+    vp_intervals.erase (vp_intervals.begin ());
+    vp_intervals.insert (boost::icl::construct<boost::icl::discrete_interval<int> >
+        (0, upper_bound, boost::icl::interval_bounds::closed ()));
+    vp_intervals.insert (boost::icl::construct<boost::icl::discrete_interval<int> >
+        (angle_resolution + lower_bound, angle_resolution - 1, boost::icl::interval_bounds::closed ()));
+  }
+  boost::icl::interval_set<int>::iterator last_element = vp_intervals.end ();
+  last_element--;
+  if (last_element->upper () >= angle_resolution)
+  {
+    lower_bound = last_element->lower ();
+    upper_bound = last_element->upper ();
+    vp_intervals.erase (last_element);
+    vp_intervals.insert (boost::icl::construct<boost::icl::discrete_interval<int> >
+        (0, upper_bound - angle_resolution, boost::icl::interval_bounds::closed ()));
+    vp_intervals.insert (boost::icl::construct<boost::icl::discrete_interval<int> >
+        (lower_bound, angle_resolution - 1, boost::icl::interval_bounds::closed ()));
+  }
+}
+
+ThreadPool::ThreadPool (size_t nr_threads) :
+  job_ (NULL), nr_items_ (0), next_item_ (0), job_id_ (0), nr_open_slots_ (0),
+  nr_running_workers_ (0), stop_ (false)
+{
+  nr_threads = resolveNrThreads (nr_threads);
+  workers_.reserve (nr_threads - 1);
+  for (size_t t = 1; t < nr_threads; ++t)
+  {
+    workers_.push_back (std::thread (&ThreadPool::workerLoop, this));
+  }
+}
+
+ThreadPool::~ThreadPool ()
+{
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    stop_ = true;
+  }
+  job_condition_.notify_all ();
+  for (size_t t = 0; t < workers_.size (); ++t)
+  {
+    workers_[t].join ();
+  }
+}
+
+void
+ThreadPool::run (size_t nr_items, size_t nr_threads, const std::function<void (size_t)> &job)
+{
+  nr_threads = std::min (std::min (resolveNrThreads (nr_threads), size ()), nr_items);
+  if (nr_threads <= 1)
+  {
+    for (size_t i = 0; i < nr_items; ++i)
+    {
+      job (i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    job_ = &job;
+    nr_items_ = nr_items;
+    next_item_ = 0;
+    exception_ = std::exception_ptr ();
+    nr_open_slots_ = nr_threads - 1;
+    job_id_++;
+  }
+  job_condition_.notify_all ();
+
+  processItems ();
+
+  std::exception_ptr exception;
+  {
+    std::unique_lock<std::mutex> lock (mutex_);
+    // workers that didn't pick up the job yet must not start it anymore
+    nr_open_slots_ = 0;
+    done_condition_.wait (lock, [this] () { return nr_running_workers_ == 0; });
+    job_ = NULL;
+    exception = exception_;
+    exception_ = std::exception_ptr ();
+  }
+  if (exception)
+  {
+    std::rethrow_exception (exception);
+  }
+}
+
+void
+ThreadPool::processItems ()
+{
+  size_t i;
+  while ((i = next_item_++) < nr_items_)
+  {
+    try
+    {
+      (*job_) (i);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock (mutex_);
+      if (!exception_)
+      {
+        exception_ = std::current_exception ();
+      }
+      next_item_ = nr_items_;
+    }
+  }
+}
+
+void
+ThreadPool::workerLoop ()
+{
+  size_t last_job_id = 0;
+  std::unique_lock<std::mutex> lock (mutex_);
+  while (true)
+  {
+    job_condition_.wait (lock, [&] () { return stop_ || (job_id_ != last_job_id && nr_open_slots_ > 0); });
+    if (stop_)
+      return;
+
+    last_job_id = job_id_;
+    nr_open_slots_--;
+    nr_running_workers_++;
+    lock.unlock ();
+    processItems ();
+    lock.lock ();
+    if (--nr_running_workers_ == 0)
+    {
+      done_condition_.notify_all ();
+    }
+  }
+}